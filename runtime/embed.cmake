@@ -0,0 +1,13 @@
+# Writes a binary file out as a C++ byte array, for the runtime bitcode that is
+# linked into the compiler. Usage:
+#   cmake -DINPUT=<file> -DOUTPUT=<file.cpp> -DNAME=<symbol> -P embed.cmake
+# defines the array NAME and its size, NAMESize.
+
+file(READ "${INPUT}" bytes HEX)
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${bytes}")
+file(WRITE "${OUTPUT}"
+    "// Generated from ${INPUT} by embed.cmake; do not edit.\n"
+    "#include <cstddef>\n\n"
+    "// Bitcode readers expect 32-bit words\n"
+    "alignas(4) extern const unsigned char ${NAME}[] = {\n    ${bytes}\n};\n"
+    "extern const size_t ${NAME}Size = sizeof(${NAME});\n")
@@ -0,0 +1,66 @@
+#include "toy_runtime.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* toy_print in print.ll writes into the buffer through its own copy of the layout,
+ * %ToyOutput = type { i32, i32, [65536 x i8] }; keep the two in step. */
+_Static_assert(offsetof(struct ToyOutput, used) == 0, "print.ll expects used at offset 0");
+_Static_assert(offsetof(struct ToyOutput, capacity) == 4, "print.ll expects capacity at offset 4");
+_Static_assert(offsetof(struct ToyOutput, data) == 8, "print.ll expects data at offset 8");
+_Static_assert(TOY_OUTPUT_SIZE == 65536, "print.ll's buffer is [65536 x i8]");
+_Static_assert(sizeof(struct ToyOutput) == 8 + TOY_OUTPUT_SIZE, "print.ll's %ToyOutput has no padding");
+
+static _Thread_local struct ToyOutput buffer;
+static pthread_key_t threadExit;       /**< Its destructor flushes an exiting thread's buffer */
+static pthread_once_t initialized = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Writes a whole buffer to stdout, retrying after partial writes and signals.
+ */
+static void writeAll(const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(STDOUT_FILENO, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+}
+
+struct ToyOutput *toy_output(void) { return &buffer; }
+
+void toy_flush(void) {
+    writeAll(buffer.data, buffer.used);
+    buffer.used = 0;
+}
+
+static void flushAtThreadExit(void *unused) {
+    (void)unused;
+    toy_flush();
+}
+
+/**
+ * @brief Flushes the buffer of the thread calling exit, usually the main thread.
+ * 
+ * Thread-specific destructors do not run for a thread that ends the process.
+ */
+static void flushAtExit(void) { toy_flush(); }
+
+static void initialize(void) {
+    pthread_key_create(&threadExit, flushAtThreadExit);
+    atexit(flushAtExit);
+}
+
+void toy_make_room(void) {
+    if (buffer.capacity == 0) {
+        pthread_once(&initialized, initialize);
+        pthread_setspecific(threadExit, &buffer); /* any non-null value enables the destructor */
+        buffer.capacity = TOY_OUTPUT_SIZE;
+    }
+    toy_flush();
+}
@@ -0,0 +1,133 @@
+; The formatting half of the print runtime, written in LLVM IR so that it can be
+; linked into each program before optimization and inlined into its loops. It is
+; assembled to bitcode at build time and embedded in the compiler; the compiler
+; links toy_print into a module only when the module prints (src/runtime_link.cpp).
+;
+; The output buffer itself stays in the C half (print.c): it is thread-local,
+; which JIT-compiled code cannot address directly, and it has to be flushed at
+; thread and process exit. toy_output hands out the calling thread's buffer.
+
+; struct ToyOutput in toy_runtime.h
+%ToyOutput = type { i32, i32, [65536 x i8] }
+
+; The decimal digits of 0 to 99, two per number
+@digitPairs = private unnamed_addr constant [200 x i8] c"00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899"
+
+; The smallest number with 1 to 10 digits (except for 0)
+@powersOfTen = private unnamed_addr constant [10 x i32] [i32 1, i32 10, i32 100, i32 1000, i32 10000, i32 100000, i32 1000000, i32 10000000, i32 100000000, i32 1000000000]
+
+; The buffer's address does not change for the life of a thread, so calls to
+; toy_output can be hoisted out of loops and merged.
+declare %ToyOutput* @toy_output() nounwind readnone willreturn
+
+; Writes out a full buffer; on a thread's first print, sets the buffer up.
+declare void @toy_make_room() nounwind cold
+
+; Writes one number and a newline into the buffer. The digits are produced from
+; the right, two per division, straight into their place in the buffer.
+define void @toy_print(i32 %value) nounwind {
+entry:
+  %output = call %ToyOutput* @toy_output()
+  %usedField = getelementptr inbounds %ToyOutput, %ToyOutput* %output, i64 0, i32 0
+  %capacityField = getelementptr inbounds %ToyOutput, %ToyOutput* %output, i64 0, i32 1
+  %usedBefore = load i32, i32* %usedField
+  %capacity = load i32, i32* %capacityField
+  %room = sub i32 %capacity, %usedBefore
+  %full = icmp ult i32 %room, 12 ; "-2147483648\n"
+  br i1 %full, label %makeRoom, label %count, !prof !0
+
+makeRoom:
+  call void @toy_make_room()
+  br label %count
+
+count:
+  %negative = icmp slt i32 %value, 0
+  %negated = sub i32 0, %value
+  %magnitude = select i1 %negative, i32 %negated, i32 %value
+  br label %countLoop
+
+countLoop:
+  %digits = phi i32 [ 1, %count ], [ %nextDigits, %countNext ]
+  %maybeMore = icmp ult i32 %digits, 10
+  br i1 %maybeMore, label %countCheck, label %write
+
+countCheck:
+  %powerIndex = zext i32 %digits to i64
+  %powerField = getelementptr inbounds [10 x i32], [10 x i32]* @powersOfTen, i64 0, i64 %powerIndex
+  %power = load i32, i32* %powerField
+  %more = icmp uge i32 %magnitude, %power
+  br i1 %more, label %countNext, label %write
+
+countNext:
+  %nextDigits = add nuw nsw i32 %digits, 1
+  br label %countLoop
+
+write:
+  %used = load i32, i32* %usedField ; toy_make_room may have emptied the buffer
+  %sign = zext i1 %negative to i32
+  %numberLength = add nuw nsw i32 %digits, %sign
+  %usedIndex = zext i32 %used to i64
+  %start = getelementptr inbounds %ToyOutput, %ToyOutput* %output, i64 0, i32 2, i64 %usedIndex
+  %newlineOffset = zext i32 %numberLength to i64
+  %newline = getelementptr inbounds i8, i8* %start, i64 %newlineOffset
+  store i8 10, i8* %newline
+  br label %pairLoop
+
+pairLoop:
+  %rest = phi i32 [ %magnitude, %write ], [ %quotient, %pair ]
+  %end = phi i8* [ %newline, %write ], [ %pairStart, %pair ]
+  %twoOrMore = icmp uge i32 %rest, 100
+  br i1 %twoOrMore, label %pair, label %lastDigits
+
+pair:
+  %quotient = udiv i32 %rest, 100
+  %remainder = urem i32 %rest, 100
+  %pairStart = getelementptr inbounds i8, i8* %end, i64 -2
+  call void @writePair(i8* %pairStart, i32 %remainder)
+  br label %pairLoop
+
+lastDigits:
+  %twoDigits = icmp uge i32 %rest, 10
+  br i1 %twoDigits, label %lastPair, label %lastDigit
+
+lastPair:
+  %lastPairStart = getelementptr inbounds i8, i8* %end, i64 -2
+  call void @writePair(i8* %lastPairStart, i32 %rest)
+  br label %minus
+
+lastDigit:
+  %lastDigitStart = getelementptr inbounds i8, i8* %end, i64 -1
+  %digit = trunc i32 %rest to i8
+  %character = add nuw i8 %digit, 48 ; '0'
+  store i8 %character, i8* %lastDigitStart
+  br label %minus
+
+minus:
+  br i1 %negative, label %writeMinus, label %done
+
+writeMinus:
+  store i8 45, i8* %start ; '-'
+  br label %done
+
+done:
+  %length = add nuw nsw i32 %numberLength, 1
+  %usedAfter = add nuw i32 %used, %length
+  store i32 %usedAfter, i32* %usedField
+  ret void
+}
+
+; Writes the two digits of a number below 100.
+define private void @writePair(i8* %to, i32 %number) alwaysinline nounwind {
+entry:
+  %index = zext i32 %number to i64
+  %offset = shl nuw nsw i64 %index, 1
+  %from = getelementptr inbounds [200 x i8], [200 x i8]* @digitPairs, i64 0, i64 %offset
+  %fromPair = bitcast i8* %from to i16*
+  %toPair = bitcast i8* %to to i16*
+  %digits = load i16, i16* %fromPair, align 1
+  store i16 %digits, i16* %toPair, align 1
+  ret void
+}
+
+; The buffer fills up once in thousands of prints
+!0 = !{!"branch_weights", i32 1, i32 4095}
@@ -0,0 +1,59 @@
+#ifndef TOY_RUNTIME_H
+#define TOY_RUNTIME_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Size of each thread's output buffer. */
+#define TOY_OUTPUT_SIZE 65536
+
+/**
+ * @brief A thread's pending output.
+ * 
+ * toy_print (runtime/print.ll) writes into it directly; its %ToyOutput type must
+ * match this layout.
+ */
+struct ToyOutput {
+    uint32_t used;                /**< Bytes of data not written yet */
+    uint32_t capacity;            /**< Usable bytes: 0 until the thread first prints */
+    char data[TOY_OUTPUT_SIZE];   /**< The pending bytes */
+};
+
+/**
+ * @brief Writes a value in decimal and a newline to stdout; the `print` builtin.
+ * 
+ * Defined in runtime/print.ll and linked into each program that prints, not in
+ * the toy_runtime library. Output goes through the calling thread's buffer,
+ * which is written out when it is full, when the thread exits and when the
+ * process exits.
+ * 
+ * @param value The value to print.
+ */
+void toy_print(int32_t value);
+
+/**
+ * @brief Returns the calling thread's output buffer.
+ */
+struct ToyOutput *toy_output(void);
+
+/**
+ * @brief Writes out the calling thread's full buffer, setting it up on the thread's first print.
+ */
+void toy_make_room(void);
+
+/**
+ * @brief Writes out the calling thread's print buffer.
+ * 
+ * Needed only where the buffer must reach stdout before the thread or process
+ * ends, e.g. after a JIT-compiled program returns to the compiler.
+ */
+void toy_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
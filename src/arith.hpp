@@ -0,0 +1,86 @@
+#ifndef ARITH_HPP
+#define ARITH_HPP
+
+#include "ast.hpp"
+#include <climits>
+#include <cstdint>
+
+/**
+ * @brief The integer semantics of the toy language.
+ * 
+ * Every `int` is a 32-bit two's complement value and no operation is undefined:
+ * 
+ * - `+`, `-` and `*` wrap around modulo 2^32;
+ * - `x / 0` is 0 and `INT_MIN / -1` is INT_MIN (division otherwise truncates toward zero);
+ * - shift amounts are taken modulo 32;
+ * - comparisons and logical operators yield 1 or 0.
+ * 
+ * Compile-time evaluation uses these helpers and the code generator must produce
+ * the same results at run time, so folding never changes what a program prints.
+ */
+namespace arith {
+
+inline int add(int a, int b) { return static_cast<int>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b)); }
+inline int sub(int a, int b) { return static_cast<int>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b)); }
+inline int mul(int a, int b) { return static_cast<int>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b)); }
+
+inline int div(int a, int b) {
+    if (b == 0) return 0;
+    if (a == INT_MIN && b == -1) return INT_MIN;
+    return a / b;
+}
+
+inline int shl(int a, int b) { return static_cast<int>(static_cast<uint32_t>(a) << (b & 31)); }
+inline int lshr(int a, int b) { return static_cast<int>(static_cast<uint32_t>(a) >> (b & 31)); }
+inline int ashr(int a, int b) { return a < 0 ? ~(~a >> (b & 31)) : a >> (b & 31); }
+
+/**
+ * @brief Returns true for `&&` and `||`, whose right operand is conditional.
+ */
+inline bool isShortCircuit(BinaryOp op) { return op == BinaryOp::And || op == BinaryOp::Or; }
+
+/**
+ * @brief Applies a binary operator to two constants.
+ * 
+ * @param op The operator.
+ * @param a The left operand.
+ * @param b The right operand.
+ * @return The result under the language's semantics.
+ */
+inline int evaluate(BinaryOp op, int a, int b) {
+    switch (op) {
+        case BinaryOp::Add: return add(a, b);
+        case BinaryOp::Sub: return sub(a, b);
+        case BinaryOp::Mul: return mul(a, b);
+        case BinaryOp::Div: return div(a, b);
+        case BinaryOp::Shl: return shl(a, b);
+        case BinaryOp::AShr: return ashr(a, b);
+        case BinaryOp::LShr: return lshr(a, b);
+        case BinaryOp::Lt: return a < b;
+        case BinaryOp::Le: return a <= b;
+        case BinaryOp::Gt: return a > b;
+        case BinaryOp::Ge: return a >= b;
+        case BinaryOp::Eq: return a == b;
+        case BinaryOp::Ne: return a != b;
+        case BinaryOp::And: return a && b;
+        case BinaryOp::Or: return a || b;
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns log2 of a positive power of two, or -1 for any other value.
+ * 
+ * @param v The value to test.
+ * @return The exponent k with v == 2^k, or -1.
+ */
+inline int exactLog2(int v) {
+    if (v <= 0 || (v & (v - 1)) != 0) return -1;
+    int k = 0;
+    while ((1 << k) != v) k++;
+    return k;
+}
+
+} // namespace arith
+
+#endif
@@ -5,14 +5,19 @@
 #include <vector>
 #include <string>
 
+class FunctionDecl;
+
 /**
  * @brief Base class for all Abstract Syntax Tree (AST) nodes.
  * 
  * This is the base class for all AST nodes. It provides a virtual destructor to ensure
- * proper cleanup of derived classes.
+ * proper cleanup of derived classes. The parser records source lines for statements
+ * and functions only; expressions take the line of their statement.
  */
 class ASTNode {
 public:
+    unsigned line = 0; ///< Source line the node starts on, counting from 1; 0 if unknown.
+
     virtual ~ASTNode() = default; ///< Virtual destructor to ensure proper cleanup of derived classes.
 };
 
@@ -34,6 +39,33 @@ public:
     explicit NumberExpr(int val) : value(val) {}
 };
 
+/**
+ * @brief The operators a BinaryExpr can apply.
+ * 
+ * The shift operators have no source syntax; they are introduced by the constant
+ * folder when it strength-reduces multiplications and divisions by powers of two.
+ * Comparisons and the logical operators yield 1 for true and 0 for false; `&&` and
+ * `||` evaluate their right operand only when the left one does not decide the
+ * result.
+ */
+enum class BinaryOp {
+    Add,  /**< Addition '+' */
+    Sub,  /**< Subtraction '-' */
+    Mul,  /**< Multiplication '*' */
+    Div,  /**< Signed division '/' */
+    Shl,  /**< Left shift */
+    AShr, /**< Arithmetic (sign-filling) right shift */
+    LShr, /**< Logical (zero-filling) right shift */
+    Lt,   /**< Signed less than '<' */
+    Le,   /**< Signed less than or equal '<=' */
+    Gt,   /**< Signed greater than '>' */
+    Ge,   /**< Signed greater than or equal '>=' */
+    Eq,   /**< Equality '==' */
+    Ne,   /**< Inequality '!=' */
+    And,  /**< Short-circuit logical and '&&' */
+    Or    /**< Short-circuit logical or '||' */
+};
+
 /**
  * @brief Represents a binary expression node in the AST (e.g., addition, subtraction).
  * 
@@ -44,7 +76,7 @@ class BinaryExpr : public ASTNode {
 public:
     std::unique_ptr<ASTNode> left;  ///< Pointer to the left operand.
     std::unique_ptr<ASTNode> right; ///< Pointer to the right operand.
-    char op; ///< The binary operator (e.g., '+', '-', '*', '/').
+    BinaryOp op; ///< The binary operator (e.g., BinaryOp::Add).
 
     /**
      * @brief Constructs a BinaryExpr with a left operand, an operator, and a right operand.
@@ -53,10 +85,15 @@ public:
      * @param o The binary operator.
      * @param r Unique pointer to the right operand.
      */
-    BinaryExpr(std::unique_ptr<ASTNode> l, char o, std::unique_ptr<ASTNode> r)
-        : left(std::move(l)), op(o), right(std::move(r)) {}
+    BinaryExpr(std::unique_ptr<ASTNode> l, BinaryOp o, std::unique_ptr<ASTNode> r)
+        : left(std::move(l)), right(std::move(r)), op(o) {}
 };
 
+/**
+ * @brief A `likely(...)` or `unlikely(...)` annotation on a branch condition.
+ */
+enum class BranchHint { None, Likely, Unlikely };
+
 /**
  * @brief Represents an "if" statement node in the AST.
  * 
@@ -68,6 +105,7 @@ public:
     std::unique_ptr<ASTNode> condition; ///< The condition to evaluate.
     std::unique_ptr<ASTNode> thenBranch; ///< The expression to execute if the condition is true.
     std::unique_ptr<ASTNode> elseBranch; ///< The expression to execute if the condition is false (optional).
+    BranchHint hint = BranchHint::None; ///< Whether the condition is expected to be true or false.
 
     /**
      * @brief Constructs an IfStatement with a condition, then branch, and optional else branch.
@@ -80,6 +118,23 @@ public:
         : condition(std::move(cond)), thenBranch(std::move(thenBr)), elseBranch(std::move(elseBr)) {}
 };
 
+/**
+ * @brief Optimization hints given with `#pragma` before a loop.
+ * 
+ * A value of 0 means no hint. A value of 1 disables the transformation; larger
+ * values force it with that factor.
+ */
+struct LoopHints {
+    unsigned unrollCount = 0;     ///< From `#pragma unroll(N)`.
+    unsigned vectorizeWidth = 0;  ///< From `#pragma vectorize(width)`.
+    unsigned interleaveCount = 0; ///< From `#pragma interleave(N)`.
+
+    /**
+     * @brief Returns true if no hint was given.
+     */
+    bool empty() const { return !unrollCount && !vectorizeWidth && !interleaveCount; }
+};
+
 /**
  * @brief Represents a "while" statement node in the AST.
  * 
@@ -90,6 +145,8 @@ class WhileStatement : public ASTNode {
 public:
     std::unique_ptr<ASTNode> condition; ///< The condition to evaluate before each iteration.
     std::unique_ptr<ASTNode> body; ///< The body of the loop to execute.
+    LoopHints hints; ///< Unroll, vectorize and interleave hints from `#pragma`s before the loop.
+    BranchHint hint = BranchHint::None; ///< Whether the condition is expected to be true or false.
 
     /**
      * @brief Constructs a WhileStatement with a condition and body.
@@ -119,6 +176,164 @@ public:
      * @param name The name of the function being called.
      */
     FunctionCall(const std::string& name) : name(name) {}
+
+    FunctionDecl *callee = nullptr; ///< The called function, bound by the Resolver (null for builtins like print).
+};
+
+/**
+ * @brief Represents a reference to a variable in the AST.
+ * 
+ * The name is bound by the Resolver to a slot, a dense per-function index that later
+ * passes use instead of the name.
+ */
+class VariableExpr : public ASTNode {
+public:
+    std::string name; ///< The name of the referenced variable.
+    int slot = -1; ///< The variable's slot in its function, assigned by the Resolver.
+
+    /**
+     * @brief Constructs a VariableExpr referring to the given name.
+     * 
+     * @param name The name of the referenced variable.
+     */
+    explicit VariableExpr(const std::string& name) : name(name) {}
+};
+
+/**
+ * @brief Represents an assignment to an existing variable (e.g., `x = x + 1;`).
+ */
+class Assignment : public ASTNode {
+public:
+    std::string name; ///< The name of the assigned variable.
+    std::unique_ptr<ASTNode> value; ///< The value being assigned.
+    int slot = -1; ///< The variable's slot in its function, assigned by the Resolver.
+
+    /**
+     * @brief Constructs an Assignment of a value to a named variable.
+     * 
+     * @param name The name of the assigned variable.
+     * @param val The value being assigned.
+     */
+    Assignment(const std::string& name, std::unique_ptr<ASTNode> val)
+        : name(name), value(std::move(val)) {}
+};
+
+/**
+ * @brief Represents a local variable declaration (e.g., `int x = 5;`).
+ * 
+ * The initializer is optional; a declaration without one starts out as zero.
+ */
+class VarDecl : public ASTNode {
+public:
+    std::string name; ///< The name of the declared variable.
+    std::unique_ptr<ASTNode> init; ///< The initial value (optional).
+    int slot = -1; ///< The variable's slot in its function, assigned by the Resolver.
+
+    /**
+     * @brief Constructs a VarDecl with a name and optional initializer.
+     * 
+     * @param name The name of the declared variable.
+     * @param init The initial value (may be null).
+     */
+    VarDecl(const std::string& name, std::unique_ptr<ASTNode> init)
+        : name(name), init(std::move(init)) {}
+};
+
+/**
+ * @brief Represents a braced block of statements, which opens a new scope.
+ */
+class Block : public ASTNode {
+public:
+    std::vector<std::unique_ptr<ASTNode>> statements; ///< The statements in source order.
+};
+
+/**
+ * @brief Represents a "return" statement node in the AST.
+ */
+class ReturnStatement : public ASTNode {
+public:
+    std::unique_ptr<ASTNode> value; ///< The returned value (optional; a bare return yields 0).
+
+    /**
+     * @brief Constructs a ReturnStatement with an optional value.
+     * 
+     * @param val The returned value (may be null).
+     */
+    explicit ReturnStatement(std::unique_ptr<ASTNode> val) : value(std::move(val)) {}
+};
+
+/**
+ * @brief One labelled section of a "switch" statement.
+ * 
+ * The section runs when the switch value equals one of its case values, or when
+ * no case matches and it carries the `default` label. As in C, control then falls
+ * through into the next section unless the statements end in `break` or `return`.
+ */
+struct SwitchCase {
+    std::vector<int> values;     ///< The values of the section's `case` labels.
+    bool isDefault = false;      ///< Whether the section also carries the `default` label.
+    std::unique_ptr<Block> body; ///< The statements up to the next label; a scope of their own.
+};
+
+/**
+ * @brief Represents a "switch" statement node in the AST.
+ * 
+ * Case values are constants and unique within a switch, and at most one section
+ * is the default, so the statement maps directly onto a multi-way branch.
+ */
+class SwitchStatement : public ASTNode {
+public:
+    std::unique_ptr<ASTNode> condition; ///< The value to dispatch on.
+    std::vector<SwitchCase> cases;      ///< The sections in source order.
+
+    /**
+     * @brief Constructs a SwitchStatement without sections.
+     * 
+     * @param cond The value to dispatch on.
+     */
+    explicit SwitchStatement(std::unique_ptr<ASTNode> cond) : condition(std::move(cond)) {}
+};
+
+/**
+ * @brief Represents a "break" statement, which leaves the innermost "while" or "switch".
+ */
+class BreakStatement : public ASTNode {};
+
+/**
+ * @brief Represents a function definition (e.g., `int add(int a, int b) { ... }`).
+ * 
+ * Parameters occupy the first slots of the function; locals declared in the body are
+ * numbered after them. numLocals is the total slot count once the Resolver has run.
+ * A function without a body is defined in another source file; the Resolver adds
+ * one for each such function a file calls.
+ */
+class FunctionDecl : public ASTNode {
+public:
+    std::string name; ///< The name of the function.
+    std::vector<std::string> params; ///< The parameter names, in order.
+    std::unique_ptr<Block> body; ///< The function body, or null for a function defined in another file.
+    int numLocals = 0; ///< Number of slots (parameters included), assigned by the Resolver.
+
+    /**
+     * @brief Constructs a FunctionDecl with a name, parameter list and body.
+     * 
+     * @param name The name of the function.
+     * @param params The parameter names, in order.
+     * @param body The function body.
+     */
+    FunctionDecl(const std::string& name, std::vector<std::string> params, std::unique_ptr<Block> body)
+        : name(name), params(std::move(params)), body(std::move(body)) {}
+};
+
+/**
+ * @brief Represents a whole translation unit.
+ * 
+ * Top-level statements outside of any function are collected by the parser into an
+ * implicit `main`, so a Program only ever holds functions.
+ */
+class Program : public ASTNode {
+public:
+    std::vector<std::unique_ptr<FunctionDecl>> functions; ///< The functions in source order.
 };
 
 #endif // AST_HPP
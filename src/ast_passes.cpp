@@ -0,0 +1,439 @@
+#include "ast_passes.hpp"
+#include "arith.hpp"
+
+/**
+ * @brief Returns the constant value of a node if it is a NumberExpr.
+ * 
+ * @param node The node to inspect.
+ * @param value Receives the constant.
+ * @return True if the node is a NumberExpr.
+ */
+static bool constantValue(const ASTNode *node, int &value) {
+    if (auto *number = dynamic_cast<const NumberExpr *>(node)) {
+        value = number->value;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Returns true if an expression always evaluates to 0 or 1.
+ */
+static bool isBoolean(const ASTNode *node) {
+    // Comparisons and the logical operators come last in BinaryOp.
+    auto *binary = dynamic_cast<const BinaryExpr *>(node);
+    return binary && binary->op >= BinaryOp::Lt;
+}
+
+/**
+ * @brief Returns the comparison that is true exactly when the given one is false.
+ */
+static BinaryOp inverseComparison(BinaryOp op) {
+    switch (op) {
+        case BinaryOp::Lt: return BinaryOp::Ge;
+        case BinaryOp::Le: return BinaryOp::Gt;
+        case BinaryOp::Gt: return BinaryOp::Le;
+        case BinaryOp::Ge: return BinaryOp::Lt;
+        case BinaryOp::Eq: return BinaryOp::Ne;
+        default: return BinaryOp::Eq;
+    }
+}
+
+/**
+ * @brief Wraps an expression as `x != 0` unless it already yields 0 or 1.
+ */
+static std::unique_ptr<ASTNode> toBoolean(std::unique_ptr<ASTNode> node) {
+    if (isBoolean(node.get())) return node;
+    return std::make_unique<BinaryExpr>(std::move(node), BinaryOp::Ne, std::make_unique<NumberExpr>(0));
+}
+
+/**
+ * @brief Returns true if a statement node is a bare expression.
+ */
+static bool isExpression(const ASTNode *node) {
+    return dynamic_cast<const NumberExpr *>(node) || dynamic_cast<const BinaryExpr *>(node) ||
+           dynamic_cast<const VariableExpr *>(node) || dynamic_cast<const FunctionCall *>(node);
+}
+
+/**
+ * @brief Returns true if a statement can be dropped without changing the program.
+ * 
+ * Empty blocks and expressions without side effects qualify.
+ */
+static bool isDeadStatement(const ASTNode *node) {
+    if (auto *block = dynamic_cast<const Block *>(node)) return block->statements.empty();
+    return isExpression(node) && !hasSideEffects(node);
+}
+
+/**
+ * @brief Returns true if evaluating an expression may have an observable effect.
+ * 
+ * @param node The expression to inspect.
+ * @return True if the expression must be evaluated even when its value is unused.
+ */
+bool hasSideEffects(const ASTNode *node) {
+    if (auto *binary = dynamic_cast<const BinaryExpr *>(node)) {
+        return hasSideEffects(binary->left.get()) || hasSideEffects(binary->right.get());
+    }
+    return dynamic_cast<const FunctionCall *>(node) != nullptr;
+}
+
+/**
+ * @brief Simplifies every function in a program in place.
+ * 
+ * @param program The program to simplify.
+ */
+void ConstantFolder::run(Program &program) {
+    for (auto &function : program.functions) {
+        if (function->body) foldBlock(*function->body);
+    }
+}
+
+/**
+ * @brief Simplifies a single expression tree.
+ * 
+ * @param node The expression; replaced in place if it simplifies.
+ */
+void ConstantFolder::foldExpression(std::unique_ptr<ASTNode> &node) {
+    if (auto replacement = simplify(node.get())) node = std::move(replacement);
+}
+
+/**
+ * @brief Simplifies the statements of a block, dropping those that became dead.
+ * 
+ * Anything after a "return" or "break" is unreachable and is dropped as well.
+ * 
+ * @param block The block to simplify.
+ */
+void ConstantFolder::foldBlock(Block &block) {
+    auto out = block.statements.begin();
+    for (auto &statement : block.statements) {
+        foldStatement(statement);
+        if (isDeadStatement(statement.get())) continue;
+        bool jumps = dynamic_cast<ReturnStatement *>(statement.get()) || dynamic_cast<BreakStatement *>(statement.get());
+        *out++ = std::move(statement);
+        if (jumps) break;
+    }
+    block.statements.erase(out, block.statements.end());
+}
+
+/**
+ * @brief Simplifies the expressions held by a statement.
+ * 
+ * A statement that disappears entirely is replaced by an empty Block, which keeps
+ * the branches of enclosing if/while statements non-null; foldBlock drops it.
+ * 
+ * @param node The statement; may be replaced in place.
+ */
+void ConstantFolder::foldStatement(std::unique_ptr<ASTNode> &node) {
+    ASTNode *statement = node.get();
+    if (!statement) return;
+
+    if (auto *block = dynamic_cast<Block *>(statement)) {
+        foldBlock(*block);
+    } else if (auto *decl = dynamic_cast<VarDecl *>(statement)) {
+        if (decl->init) foldExpression(decl->init);
+    } else if (auto *assign = dynamic_cast<Assignment *>(statement)) {
+        foldExpression(assign->value);
+    } else if (auto *ifStmt = dynamic_cast<IfStatement *>(statement)) {
+        foldExpression(ifStmt->condition);
+        int value = 0;
+        if (constantValue(ifStmt->condition.get(), value)) {
+            // Keep only the branch that is taken; the resolver has already bound
+            // every name, so hoisting it into the enclosing block is safe.
+            std::unique_ptr<ASTNode> taken = std::move(value ? ifStmt->thenBranch : ifStmt->elseBranch);
+            node = taken ? std::move(taken) : std::make_unique<Block>();
+            foldStatement(node);
+            return;
+        }
+        foldStatement(ifStmt->thenBranch);
+        foldStatement(ifStmt->elseBranch);
+        if (ifStmt->elseBranch && isDeadStatement(ifStmt->elseBranch.get())) ifStmt->elseBranch = nullptr;
+        if (!ifStmt->elseBranch && isDeadStatement(ifStmt->thenBranch.get()) &&
+            !hasSideEffects(ifStmt->condition.get())) {
+            node = std::make_unique<Block>();
+        }
+    } else if (auto *whileStmt = dynamic_cast<WhileStatement *>(statement)) {
+        foldExpression(whileStmt->condition);
+        int value = 0;
+        if (constantValue(whileStmt->condition.get(), value) && value == 0) {
+            node = std::make_unique<Block>();
+            return;
+        }
+        foldStatement(whileStmt->body);
+    } else if (auto *switchStmt = dynamic_cast<SwitchStatement *>(statement)) {
+        // A constant value still leaves the sections in place: which statements run
+        // depends on fallthrough and nested breaks, and LLVM folds the branch anyway.
+        foldExpression(switchStmt->condition);
+        for (auto &section : switchStmt->cases) foldBlock(*section.body);
+    } else if (auto *ret = dynamic_cast<ReturnStatement *>(statement)) {
+        if (ret->value) foldExpression(ret->value);
+    } else {
+        foldExpression(node);
+    }
+}
+
+/**
+ * @brief Simplifies an expression after simplifying its operands.
+ * 
+ * @param node The expression to simplify.
+ * @return The replacement for the node, or null to keep the (possibly updated) node.
+ */
+std::unique_ptr<ASTNode> ConstantFolder::simplify(ASTNode *node) {
+    if (auto *binary = dynamic_cast<BinaryExpr *>(node)) {
+        foldExpression(binary->left);
+        foldExpression(binary->right);
+        return simplifyBinary(*binary);
+    }
+    if (auto *call = dynamic_cast<FunctionCall *>(node)) {
+        // Arguments are shared pointers, so they are replaced rather than reset.
+        for (auto &arg : call->args) {
+            if (auto replacement = simplify(arg.get())) arg = std::move(replacement);
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Applies folding, identities and strength reduction to one binary node.
+ * 
+ * The operands have already been simplified.
+ * 
+ * @param binary The node to simplify.
+ * @return The replacement for the node, or null to keep it.
+ */
+std::unique_ptr<ASTNode> ConstantFolder::simplifyBinary(BinaryExpr &binary) {
+    int l = 0, r = 0;
+    bool leftConst = constantValue(binary.left.get(), l);
+    bool rightConst = constantValue(binary.right.get(), r);
+
+    if (leftConst && rightConst) {
+        return std::make_unique<NumberExpr>(arith::evaluate(binary.op, l, r));
+    }
+
+    // Canonicalize constants to the right of commutative operators.
+    if (leftConst && (binary.op == BinaryOp::Add || binary.op == BinaryOp::Mul)) {
+        std::swap(binary.left, binary.right);
+        std::swap(l, r);
+        std::swap(leftConst, rightConst);
+    }
+
+    // x - c is x + (-c); wrapping makes this exact even for INT_MIN.
+    if (rightConst && binary.op == BinaryOp::Sub) {
+        binary.op = BinaryOp::Add;
+        r = arith::sub(0, r);
+        static_cast<NumberExpr *>(binary.right.get())->value = r;
+    }
+
+    // (x + c1) + c2 is x + (c1 + c2).
+    if (rightConst && binary.op == BinaryOp::Add) {
+        auto *inner = dynamic_cast<BinaryExpr *>(binary.left.get());
+        int c1 = 0;
+        if (inner && inner->op == BinaryOp::Add && constantValue(inner->right.get(), c1)) {
+            r = arith::add(c1, r);
+            static_cast<NumberExpr *>(binary.right.get())->value = r;
+            binary.left = std::move(inner->left);
+        }
+    }
+
+    switch (binary.op) {
+        case BinaryOp::Add:
+            if (rightConst && r == 0) return std::move(binary.left);
+            break;
+
+        case BinaryOp::Sub: {
+            auto *a = dynamic_cast<VariableExpr *>(binary.left.get());
+            auto *b = dynamic_cast<VariableExpr *>(binary.right.get());
+            if (a && b && a->slot == b->slot) return std::make_unique<NumberExpr>(0);
+            break;
+        }
+
+        case BinaryOp::Mul:
+            if (!rightConst) break;
+            if (r == 1) return std::move(binary.left);
+            if (r == 0 && !hasSideEffects(binary.left.get())) return std::make_unique<NumberExpr>(0);
+            if (r == -1) {
+                return std::make_unique<BinaryExpr>(std::make_unique<NumberExpr>(0), BinaryOp::Sub,
+                                                    std::move(binary.left));
+            }
+            if (int k = arith::exactLog2(r); k > 0) {
+                binary.op = BinaryOp::Shl;
+                static_cast<NumberExpr *>(binary.right.get())->value = k;
+            }
+            break;
+
+        case BinaryOp::Div: {
+            if (leftConst && l == 0 && !hasSideEffects(binary.right.get())) {
+                return std::make_unique<NumberExpr>(0);
+            }
+            if (!rightConst) break;
+            if (r == 1) return std::move(binary.left);
+            if (r == 0 && !hasSideEffects(binary.left.get())) return std::make_unique<NumberExpr>(0);
+            if (r == -1) {
+                // 0 - INT_MIN wraps to INT_MIN, matching INT_MIN / -1.
+                return std::make_unique<BinaryExpr>(std::make_unique<NumberExpr>(0), BinaryOp::Sub,
+                                                    std::move(binary.left));
+            }
+            // Signed division by 2^k rounds toward zero, so negative dividends are biased
+            // by 2^k - 1 before shifting: (x + ((x >> 31) >>> (32 - k))) >> k. The dividend
+            // is used twice, which is only worth it (and only safe) for plain variables.
+            int k = arith::exactLog2(r);
+            auto *var = dynamic_cast<VariableExpr *>(binary.left.get());
+            if (k > 0 && var) {
+                auto copy = std::make_unique<VariableExpr>(var->name);
+                copy->slot = var->slot;
+                auto sign = std::make_unique<BinaryExpr>(std::move(copy), BinaryOp::AShr, std::make_unique<NumberExpr>(31));
+                auto bias = std::make_unique<BinaryExpr>(std::move(sign), BinaryOp::LShr, std::make_unique<NumberExpr>(32 - k));
+                auto biased = std::make_unique<BinaryExpr>(std::move(binary.left), BinaryOp::Add, std::move(bias));
+                return std::make_unique<BinaryExpr>(std::move(biased), BinaryOp::AShr, std::make_unique<NumberExpr>(k));
+            }
+            break;
+        }
+
+        case BinaryOp::Shl:
+        case BinaryOp::AShr:
+        case BinaryOp::LShr:
+            if (rightConst && (r & 31) == 0) return std::move(binary.left);
+            break;
+
+        case BinaryOp::Eq:
+        case BinaryOp::Ne:
+            // b != 0 is b and b == 0 is the inverse comparison when b is already 0 or 1.
+            if (rightConst && r == 0 && isBoolean(binary.left.get())) {
+                if (binary.op == BinaryOp::Ne) return std::move(binary.left);
+                auto *inner = dynamic_cast<BinaryExpr *>(binary.left.get());
+                if (inner && inner->op != BinaryOp::And && inner->op != BinaryOp::Or) {
+                    inner->op = inverseComparison(inner->op);
+                    return std::move(binary.left);
+                }
+            }
+            break;
+
+        case BinaryOp::And:
+        case BinaryOp::Or: {
+            // A constant left operand decides the result or leaves x != 0; the right
+            // operand may be dropped unevaluated. A constant right operand only decides
+            // the result if the left one can be dropped.
+            bool isAnd = binary.op == BinaryOp::And;
+            if (leftConst) {
+                if ((l != 0) != isAnd) return std::make_unique<NumberExpr>(isAnd ? 0 : 1);
+                return toBoolean(std::move(binary.right));
+            }
+            if (rightConst) {
+                if ((r != 0) == isAnd) return toBoolean(std::move(binary.left));
+                if (!hasSideEffects(binary.left.get())) return std::make_unique<NumberExpr>(isAnd ? 0 : 1);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Constructs an evaluator with a per-call step budget.
+ * 
+ * @param stepBudget Maximum evaluation steps spent on any single call; 0 disables the pass.
+ */
+CallEvaluator::CallEvaluator(unsigned long stepBudget) : stepBudget(stepBudget), interpreter(stepBudget) {}
+
+/**
+ * @brief Evaluates every eligible call in a program in place.
+ * 
+ * @param program A resolved program.
+ * @return The number of calls replaced.
+ */
+unsigned CallEvaluator::run(Program &program) {
+    if (stepBudget == 0) return 0;
+
+    effects.run(program);
+    replaced = 0;
+    for (auto &function : program.functions) {
+        if (function->body) evaluateStatement(function->body.get());
+    }
+    return replaced;
+}
+
+/**
+ * @brief Evaluates the calls inside the expressions held by a statement.
+ * 
+ * @param node The statement; may be null.
+ */
+void CallEvaluator::evaluateStatement(ASTNode *node) {
+    if (!node) return;
+
+    if (auto *block = dynamic_cast<Block *>(node)) {
+        for (auto &statement : block->statements) {
+            if (isExpression(statement.get())) {
+                evaluateChild(statement);
+            } else {
+                evaluateStatement(statement.get());
+            }
+        }
+    } else if (auto *decl = dynamic_cast<VarDecl *>(node)) {
+        if (decl->init) evaluateChild(decl->init);
+    } else if (auto *assign = dynamic_cast<Assignment *>(node)) {
+        evaluateChild(assign->value);
+    } else if (auto *ifStmt = dynamic_cast<IfStatement *>(node)) {
+        evaluateChild(ifStmt->condition);
+        evaluateStatement(ifStmt->thenBranch.get());
+        evaluateStatement(ifStmt->elseBranch.get());
+    } else if (auto *whileStmt = dynamic_cast<WhileStatement *>(node)) {
+        evaluateChild(whileStmt->condition);
+        evaluateStatement(whileStmt->body.get());
+    } else if (auto *switchStmt = dynamic_cast<SwitchStatement *>(node)) {
+        evaluateChild(switchStmt->condition);
+        for (auto &section : switchStmt->cases) evaluateStatement(section.body.get());
+    } else if (auto *ret = dynamic_cast<ReturnStatement *>(node)) {
+        if (ret->value) evaluateChild(ret->value);
+    } else if (isExpression(node)) {
+        evaluateExpression(node);
+    }
+}
+
+/**
+ * @brief Evaluates an expression child in place.
+ * 
+ * @param node The child; replaced if it evaluates to a constant.
+ */
+void CallEvaluator::evaluateChild(std::unique_ptr<ASTNode> &node) {
+    if (auto replacement = evaluateExpression(node.get())) node = std::move(replacement);
+}
+
+/**
+ * @brief Evaluates the eligible calls in an expression, innermost first.
+ * 
+ * @param node The expression.
+ * @return A NumberExpr replacing the node if it was an evaluated call, otherwise null.
+ */
+std::unique_ptr<ASTNode> CallEvaluator::evaluateExpression(ASTNode *node) {
+    if (auto *binary = dynamic_cast<BinaryExpr *>(node)) {
+        evaluateChild(binary->left);
+        evaluateChild(binary->right);
+        return nullptr;
+    }
+
+    auto *call = dynamic_cast<FunctionCall *>(node);
+    if (!call) return nullptr;
+
+    std::vector<int> args;
+    bool constant = true;
+    for (auto &arg : call->args) {
+        if (auto replacement = evaluateExpression(arg.get())) arg = std::move(replacement);
+        int value = 0;
+        if (constantValue(arg.get(), value)) {
+            args.push_back(value);
+        } else {
+            constant = false;
+        }
+    }
+
+    int result = 0;
+    if (constant && call->callee && effects.get(call->callee).isPure() && interpreter.call(*call->callee, args, result)) {
+        replaced++;
+        return std::make_unique<NumberExpr>(result);
+    }
+    return nullptr;
+}
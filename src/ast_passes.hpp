@@ -0,0 +1,92 @@
+#ifndef AST_PASSES_HPP
+#define AST_PASSES_HPP
+
+#include "ast.hpp"
+#include "effects.hpp"
+#include "interpreter.hpp"
+
+/**
+ * @brief Returns true if evaluating an expression may have an observable effect.
+ * 
+ * Any call is conservatively assumed to have side effects.
+ * 
+ * @param node The expression to inspect.
+ * @return True if the expression must be evaluated even when its value is unused.
+ */
+bool hasSideEffects(const ASTNode *node);
+
+/**
+ * @brief Folds constant arithmetic and simplifies algebraic identities.
+ * 
+ * Runs on a resolved Program before code generation. Constant operands are folded
+ * using the semantics in arith.hpp; `x+0`, `x*1`, `x/1`, and `x*0` (when x has
+ * no side effects) are simplified; constant addends are reassociated;
+ * multiplications and divisions by powers of two are strength-reduced to shifts;
+ * `&&` and `||` with a constant operand are decided where possible; and negated
+ * comparisons are inverted.
+ * 
+ * Control flow whose condition folds to a constant is resolved as well: an "if"
+ * is replaced by the branch it takes and a "while" whose condition is false is
+ * removed. Expression statements left without side effects, empty blocks, and
+ * statements following a "return" or "break" are removed too.
+ */
+class ConstantFolder {
+public:
+    /**
+     * @brief Simplifies every function in a program in place.
+     * 
+     * @param program The program to simplify.
+     */
+    void run(Program &program);
+
+    /**
+     * @brief Simplifies a single expression tree.
+     * 
+     * @param node The expression; replaced in place if it simplifies.
+     */
+    void foldExpression(std::unique_ptr<ASTNode> &node);
+
+private:
+    void foldStatement(std::unique_ptr<ASTNode> &node);
+    void foldBlock(Block &block);
+    std::unique_ptr<ASTNode> simplify(ASTNode *node);
+    std::unique_ptr<ASTNode> simplifyBinary(BinaryExpr &binary);
+};
+
+/**
+ * @brief Replaces calls to pure functions with constant arguments by their result.
+ * 
+ * Each candidate call is run by the compile-time Interpreter under a step budget;
+ * calls that exceed it are left for run time. Calls are visited innermost first,
+ * so `f(g(1), 2)` can collapse completely. Running the ConstantFolder afterwards
+ * propagates the new constants.
+ */
+class CallEvaluator {
+public:
+    /**
+     * @brief Constructs an evaluator with a per-call step budget.
+     * 
+     * @param stepBudget Maximum evaluation steps spent on any single call; 0 disables the pass.
+     */
+    explicit CallEvaluator(unsigned long stepBudget);
+
+    /**
+     * @brief Evaluates every eligible call in a program in place.
+     * 
+     * @param program A resolved program.
+     * @return The number of calls replaced.
+     */
+    unsigned run(Program &program);
+
+private:
+    void evaluateStatement(ASTNode *node);
+    std::unique_ptr<ASTNode> evaluateExpression(ASTNode *node);
+    void evaluateChild(std::unique_ptr<ASTNode> &node);
+
+    unsigned long stepBudget;                         ///< Per-call step budget.
+    Interpreter interpreter;                          ///< Evaluates the calls.
+    EffectAnalysis effects;                           ///< Tells which functions are pure.
+    unsigned replaced = 0;                            ///< Calls replaced so far.
+};
+
+#endif
@@ -0,0 +1,586 @@
+#include "backend.hpp"
+#include "code_size.hpp"
+#include "optimizer.hpp"
+#include "pass_report.hpp"
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Module.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <iostream>
+#include <mutex>
+
+/**
+ * @brief Returns the code generator optimization level for the command line settings.
+ */
+llvm::CodeGenOpt::Level codeGenOptLevel(const CompilerOptions &options) {
+    if (options.fastCodegen) return llvm::CodeGenOpt::None;
+    switch (options.optLevel) {
+        case OptLevel::O0: return llvm::CodeGenOpt::None;
+        case OptLevel::O1: return llvm::CodeGenOpt::Less;
+        case OptLevel::O3: return llvm::CodeGenOpt::Aggressive;
+        default: return llvm::CodeGenOpt::Default;
+    }
+}
+
+/**
+ * @brief Resolves the target CPU and features from -mcpu and -mattr.
+ * 
+ * @param options The command line settings.
+ * @return The selected CPU and features.
+ */
+TargetSelection selectTarget(const CompilerOptions &options) {
+    TargetSelection target;
+    std::vector<std::string> features;
+    if (options.cpu.empty() || options.cpu == "native") {
+        target.cpu = llvm::sys::getHostCPUName().str();
+        llvm::StringMap<bool> hostFeatures;
+        if (llvm::sys::getHostCPUFeatures(hostFeatures)) {
+            for (const auto &feature : hostFeatures) {
+                features.push_back((feature.getValue() ? "+" : "-") + feature.getKey().str());
+            }
+            // StringMap iteration order is unspecified; keep the attribute stable across runs.
+            std::sort(features.begin(), features.end(), [](const std::string &a, const std::string &b) {
+                return a.compare(1, std::string::npos, b, 1, std::string::npos) < 0;
+            });
+        }
+    } else {
+        target.cpu = options.cpu;
+    }
+    if (!options.attrs.empty()) features.push_back(options.attrs);
+
+    for (const std::string &feature : features) {
+        if (!target.features.empty()) target.features += ",";
+        target.features += feature;
+    }
+    return target;
+}
+
+/**
+ * @brief Registers the native target; safe to call from several threads.
+ */
+static void initializeNativeTarget() {
+    // Registration is not thread-safe, and partitions create their machines concurrently.
+    static std::once_flag initialized;
+    std::call_once(initialized, [] {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+    });
+}
+
+/**
+ * @brief Returns true if the target knows a subtarget feature.
+ * 
+ * The feature tables are private to MCSubtargetInfo, so the feature is probed:
+ * enabling and disabling a known feature give different feature bits, while an
+ * unknown one is ignored either way. LLVM warns about an unknown feature on
+ * stderr as it ignores it, so stderr is muted during the probe.
+ */
+static bool isKnownFeature(const llvm::Target &target, const std::string &triple, const std::string &cpu,
+                           const std::string &name) {
+    std::fflush(stderr);
+    int savedStderr = dup(STDERR_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    if (null >= 0) {
+        dup2(null, STDERR_FILENO);
+        close(null);
+    }
+    std::unique_ptr<llvm::MCSubtargetInfo> enabled(target.createMCSubtargetInfo(triple, cpu, "+" + name));
+    std::unique_ptr<llvm::MCSubtargetInfo> disabled(target.createMCSubtargetInfo(triple, cpu, "-" + name));
+    if (savedStderr >= 0) {
+        dup2(savedStderr, STDERR_FILENO);
+        close(savedStderr);
+    }
+    return enabled && disabled && enabled->getFeatureBits() != disabled->getFeatureBits();
+}
+
+/**
+ * @brief Checks -mcpu and -mattr against the native target's processor and feature tables.
+ * 
+ * @param options The command line settings.
+ * @return False if the CPU or a feature is unknown (reported to std::cerr).
+ */
+bool checkTarget(const CompilerOptions &options) {
+    initializeNativeTarget();
+    std::string triple = llvm::sys::getDefaultTargetTriple();
+    std::string error;
+    const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple, error);
+    if (!target) {
+        std::cerr << "Unknown target " << triple << ": " << error << "\n";
+        return false;
+    }
+
+    std::string cpu = options.cpu;
+    if (cpu.empty() || cpu == "native") {
+        cpu = llvm::sys::getHostCPUName().str();
+    } else {
+        std::unique_ptr<llvm::MCSubtargetInfo> generic(target->createMCSubtargetInfo(triple, "", ""));
+        if (!generic || !generic->isCPUStringValid(cpu)) {
+            std::cerr << "unknown CPU '" << cpu << "' for " << triple << " (llc -mcpu=help lists them)\n";
+            return false;
+        }
+    }
+
+    llvm::SmallVector<llvm::StringRef, 8> features;
+    llvm::StringRef(options.attrs).split(features, ',', -1, /*KeepEmpty=*/false);
+    for (llvm::StringRef feature : features) {
+        if (feature[0] != '+' && feature[0] != '-') {
+            std::cerr << "-mattr feature '" << feature.str() << "' must start with '+' or '-'\n";
+            return false;
+        }
+        if (!isKnownFeature(*target, triple, cpu, feature.drop_front().str())) {
+            std::cerr << "unknown feature '" << feature.drop_front().str() << "' in -mattr (llc -mattr=help lists them)\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Returns the code generator options for the command line settings.
+ * 
+ * The outliner only runs by default on functions the target considers worth it,
+ * which on x86 is none, so --size also sets the code generator's
+ * -enable-machine-outliner=always option, as `clang -mllvm` would.
+ * 
+ * @param options The command line settings.
+ * @return The options for a target machine or the JIT.
+ */
+llvm::TargetOptions targetOptions(const CompilerOptions &options) {
+    llvm::TargetOptions target;
+    if (options.size) {
+        static std::once_flag outlineEverywhere;
+        std::call_once(outlineEverywhere, [] {
+            llvm::StringMap<llvm::cl::Option *> &registered = llvm::cl::getRegisteredOptions();
+            auto outliner = registered.find("enable-machine-outliner");
+            if (outliner != registered.end()) {
+                outliner->second->addOccurrence(0, "enable-machine-outliner", "always");
+            }
+        });
+        target.EnableMachineOutliner = true;
+        target.SupportsDefaultOutlining = true;
+    }
+    // What TargetMachine::setFastISel records; the selector itself follows from
+    // the None optimization level (see codeGenOptLevel).
+    target.EnableFastISel = options.fastCodegen;
+    return target;
+}
+
+/**
+ * @brief Creates a target machine for a module's target triple and the selected CPU.
+ * 
+ * @param module The module whose triple to target.
+ * @param options The command line settings (optimization level, -mcpu, -mattr).
+ * @return The target machine, or null if the target is unknown.
+ */
+std::unique_ptr<llvm::TargetMachine> createTargetMachine(const llvm::Module &module, const CompilerOptions &options) {
+    initializeNativeTarget();
+
+    std::string error;
+    const llvm::Target *target = llvm::TargetRegistry::lookupTarget(module.getTargetTriple(), error);
+    if (!target) {
+        std::cerr << "Unknown target " << module.getTargetTriple() << ": " << error << "\n";
+        return nullptr;
+    }
+    TargetSelection selection = selectTarget(options);
+    return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(
+        module.getTargetTriple(), selection.cpu, selection.features, targetOptions(options), llvm::Reloc::PIC_,
+        llvm::None, codeGenOptLevel(options)));
+}
+
+/**
+ * @brief Generates assembly or object code for a module in memory.
+ * 
+ * The code generator writes into a growable in-memory buffer, which avoids both
+ * small unbuffered writes and the seeking an object writer needs on a file.
+ * 
+ * @param module The module; its data layout must match the target machine's.
+ * @param machine The target machine to generate code with.
+ * @param fileType Whether to produce assembly or an object file.
+ * @param out Receives the generated file.
+ * @return False if the target cannot emit that kind of file.
+ */
+bool generateCode(llvm::Module &module, llvm::TargetMachine &machine, llvm::CodeGenFileType fileType,
+                  llvm::SmallVectorImpl<char> &out) {
+    llvm::raw_svector_ostream stream(out);
+    llvm::legacy::PassManager passes;
+    if (machine.addPassesToEmitFile(passes, stream, nullptr, fileType)) {
+        std::cerr << "The target cannot emit this kind of file\n";
+        return false;
+    }
+    passes.run(module);
+    return true;
+}
+
+/**
+ * @brief Runs a system tool and waits for it.
+ * 
+ * @param tool The program name, looked up in PATH.
+ * @param args The arguments, without the program name.
+ * @return False if the tool cannot be found or fails.
+ */
+static bool runTool(const char *tool, const std::vector<std::string> &args) {
+    auto program = llvm::sys::findProgramByName(tool);
+    if (!program) {
+        std::cerr << "Could not find '" << tool << "'\n";
+        return false;
+    }
+
+    std::vector<llvm::StringRef> argv{*program};
+    argv.insert(argv.end(), args.begin(), args.end());
+    std::string error;
+    int status = llvm::sys::ExecuteAndWait(*program, argv, llvm::None, {}, 0, 0, &error);
+    if (status != 0) {
+        std::cerr << tool << " failed" << (error.empty() ? "" : ": " + error) << "\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Links object files into an executable with the system C compiler driver.
+ * 
+ * @param objectFiles The object files to link.
+ * @param outputFile The executable to create.
+ * @return False if the driver cannot be found or fails.
+ */
+bool linkExecutable(const std::vector<std::string> &objectFiles, const std::string &outputFile) {
+    std::vector<std::string> args(objectFiles);
+    args.insert(args.end(), {TOY_RUNTIME_LIBRARY, "-o", outputFile});
+    return runTool("cc", args);
+}
+
+/**
+ * @brief Combines object files into one relocatable object with the system linker.
+ * 
+ * @param objectFiles The object files to combine.
+ * @param outputFile The object file to create.
+ * @return False if the linker cannot be found or fails.
+ */
+bool linkRelocatable(const std::vector<std::string> &objectFiles, const std::string &outputFile) {
+    std::vector<std::string> args{"-r", "-o", outputFile};
+    args.insert(args.end(), objectFiles.begin(), objectFiles.end());
+    return runTool("ld", args);
+}
+
+/**
+ * @brief Returns true if code generation for these options runs on partitions of the module.
+ */
+bool splitsCodeGeneration(const CompilerOptions &options) {
+    return options.jobs != 1 && !options.jit &&
+           (options.emit == EmitKind::Object || options.emit == EmitKind::Executable);
+}
+
+/**
+ * @brief Optimizes and compiles one partition, given as bitcode, in a context of its own.
+ */
+static bool compilePartition(llvm::StringRef bitcode, const CompilerOptions &options, PassReport *report,
+                             llvm::SmallVectorImpl<char> &object) {
+    llvm::LLVMContext context;
+    auto module = llvm::parseBitcodeFile(llvm::MemoryBufferRef(bitcode, "partition"), context);
+    if (!module) {
+        std::cerr << "Could not load partition: " << llvm::toString(module.takeError()) << "\n";
+        return false;
+    }
+    if (!Optimizer(options, report, PipelineStage::PostSplit).run(**module)) {
+        return false;
+    }
+    std::unique_ptr<llvm::TargetMachine> machine = createTargetMachine(**module, options);
+    return machine && generateCode(**module, *machine, llvm::CGFT_ObjectFile, object);
+}
+
+/**
+ * @brief Splits a module into partitions and compiles them to objects concurrently.
+ * 
+ * @param module The module, optimized with the PreSplit stage.
+ * @param options The command line settings; jobs is the number of partitions and threads.
+ * @param objects Receives one object file per partition.
+ * @param report Receives the partitions' pipeline timings and statistics; may be null.
+ * @return False if any partition failed.
+ */
+bool generateObjectsInParallel(llvm::Module &module, const CompilerOptions &options,
+                               std::vector<llvm::SmallVector<char, 0>> &objects, PassReport *report) {
+    unsigned jobs = options.jobs ? options.jobs : llvm::hardware_concurrency().compute_thread_count();
+    unsigned definitions = 0;
+    for (const llvm::Function &function : module) {
+        if (!function.isDeclaration()) definitions++;
+    }
+    unsigned partitions = std::max(1u, std::min(jobs, definitions));
+
+    // The partitions share the module's context, which must not be used from several
+    // threads, so each one is moved into a context of its own through bitcode here.
+    std::vector<llvm::SmallVector<char, 0>> bitcode;
+    llvm::SplitModule(module, partitions, [&](std::unique_ptr<llvm::Module> partition) {
+        bitcode.emplace_back();
+        llvm::raw_svector_ostream out(bitcode.back());
+        llvm::WriteBitcodeToFile(*partition, out);
+    });
+
+    objects.assign(bitcode.size(), {});
+    std::vector<char> compiled(bitcode.size(), false); // not vector<bool>: written concurrently
+    std::vector<std::unique_ptr<PassReport>> reports(bitcode.size());
+    llvm::ThreadPool pool(llvm::hardware_concurrency(partitions));
+    for (size_t i = 0; i < bitcode.size(); i++) {
+        if (report) reports[i] = std::make_unique<PassReport>(options.timePasses, options.stats);
+        pool.async([&, i] {
+            compiled[i] = compilePartition(llvm::StringRef(bitcode[i].data(), bitcode[i].size()), options,
+                                           reports[i].get(), objects[i]);
+        });
+    }
+    pool.wait();
+    for (const auto &partition : reports) {
+        if (partition) report->merge(*partition);
+    }
+    return std::all_of(compiled.begin(), compiled.end(), [](char ok) { return ok; });
+}
+
+namespace {
+
+/// Size of the write buffer of output files. The default is a few kilobytes, which
+/// turns a multi-megabyte module into thousands of write calls.
+constexpr size_t outputBufferSize = 1 << 20;
+
+/**
+ * @brief A destination for compiler output: a file, stdout, or a pipe to a command.
+ * 
+ * Writes go through a raw_fd_ostream with a large buffer. A FIFO can be given as
+ * an ordinary output path; with a pipe command the command is started before
+ * anything is generated, so it can consume the output while it is being written.
+ */
+class Output {
+public:
+    /**
+     * @brief Opens the destination.
+     * 
+     * @param path A file path, or "-" for stdout; ignored if command is non-empty.
+     * @param command A shell command to pipe the output into, or empty.
+     * @return False if it could not be opened (reported to std::cerr).
+     */
+    bool open(const std::string &path, const std::string &command) {
+        if (!command.empty()) {
+            pipe = popen(command.c_str(), "w");
+            if (!pipe) {
+                std::cerr << "Could not run " << command << "\n";
+                return false;
+            }
+            stream = std::make_unique<llvm::raw_fd_ostream>(fileno(pipe), false);
+        } else {
+            std::error_code error;
+            stream = std::make_unique<llvm::raw_fd_ostream>(path, error);
+            if (error) {
+                std::cerr << "Could not open " << path << ": " << error.message() << "\n";
+                return false;
+            }
+        }
+        stream->SetBufferSize(outputBufferSize);
+        return true;
+    }
+
+    /**
+     * @brief Returns the stream to write to.
+     */
+    llvm::raw_fd_ostream &get() { return *stream; }
+
+    /**
+     * @brief Flushes the output and, for a pipe, waits for the command.
+     * 
+     * @return False if writing failed or the command did not succeed.
+     */
+    bool close() {
+        stream->flush();
+        bool ok = !stream->has_error();
+        if (!ok) {
+            std::cerr << "Error writing output: " << stream->error().message() << "\n";
+            stream->clear_error();
+        }
+        stream.reset();
+        if (pipe) {
+            int status = pclose(pipe);
+            pipe = nullptr;
+            if (status != 0) {
+                std::cerr << "Output command failed with status "
+                          << (WIFEXITED(status) ? WEXITSTATUS(status) : status) << "\n";
+                ok = false;
+            }
+        }
+        return ok;
+    }
+
+private:
+    std::unique_ptr<llvm::raw_fd_ostream> stream; ///< The buffered stream.
+    FILE *pipe = nullptr;                         ///< The pipe to the output command, if any.
+};
+
+} // namespace
+
+/**
+ * @brief Returns the output path used when -o is not given: the input with a new extension.
+ * 
+ * Executables drop the extension; if that would overwrite the input, a.out is used.
+ * 
+ * @param inputFile The source file.
+ * @param extension The new extension, without the dot; empty for an executable.
+ */
+std::string defaultOutputFile(const std::string &inputFile, llvm::StringRef extension) {
+    llvm::SmallString<128> path(inputFile);
+    llvm::sys::path::replace_extension(path, extension);
+    if (path == inputFile) return "a.out";
+    return std::string(path);
+}
+
+/**
+ * @brief Writes a buffer to a file.
+ * 
+ * @param path The file path, or "-" for stdout.
+ * @param contents What to write.
+ * @return False if the file could not be written.
+ */
+bool writeFile(const std::string &path, llvm::StringRef contents) {
+    Output output;
+    if (!output.open(path, "")) return false;
+    output.get() << contents;
+    return output.close();
+}
+
+/**
+ * @brief Writes a module in the form selected on the command line.
+ * 
+ * With more than one job, objects and executables are generated from partitions of
+ * the module in parallel; a partitioned object is combined with `ld -r`.
+ * Binary output (bitcode, objects) is not written to a terminal.
+ * 
+ * @param module The optimized module.
+ * @param options The command line settings.
+ * @return False if any step failed.
+ */
+bool emitModule(llvm::Module &module, const CompilerOptions &options, PassReport *report) {
+    bool binary = options.emit == EmitKind::Bitcode || options.emit == EmitKind::Object;
+    std::string path = options.outputFile;
+    if (path.empty()) {
+        switch (options.emit) {
+            case EmitKind::IR: path = "-"; break;
+            case EmitKind::Bitcode: path = defaultOutputFile(options.inputFiles.front(), "bc"); break;
+            case EmitKind::Asm: path = defaultOutputFile(options.inputFiles.front(), "s"); break;
+            case EmitKind::Object: path = defaultOutputFile(options.inputFiles.front(), "o"); break;
+            case EmitKind::Executable: path = defaultOutputFile(options.inputFiles.front(), ""); break;
+        }
+    }
+    if (binary && path == "-" && options.pipeCommand.empty() && llvm::outs().is_displayed()) {
+        std::cerr << "Not writing binary output to a terminal; use -o or --pipe-to\n";
+        return false;
+    }
+    if (options.emit == EmitKind::Executable && !options.pipeCommand.empty()) {
+        std::cerr << "--pipe-to cannot be used with --emit=exe\n";
+        return false;
+    }
+
+    if (options.size && options.emit != EmitKind::Object && options.emit != EmitKind::Executable) {
+        std::cerr << "note: the code size report needs object code (--emit=obj, --emit=exe or --jit)\n";
+    }
+
+    if (options.emit == EmitKind::IR || options.emit == EmitKind::Bitcode) {
+        Output output;
+        if (!output.open(path, options.pipeCommand)) return false;
+        if (options.emit == EmitKind::IR) {
+            module.print(output.get(), nullptr);
+        } else {
+            llvm::WriteBitcodeToFile(module, output.get());
+        }
+        return output.close();
+    }
+
+    bool assembly = options.emit == EmitKind::Asm;
+    std::vector<llvm::SmallVector<char, 0>> objects;
+    if (splitsCodeGeneration(options)) {
+        if (!generateObjectsInParallel(module, options, objects, report)) return false;
+    } else {
+        std::unique_ptr<llvm::TargetMachine> machine = createTargetMachine(module, options);
+        if (!machine) return false;
+        module.setDataLayout(machine->createDataLayout());
+        objects.emplace_back();
+        if (!generateCode(module, *machine, assembly ? llvm::CGFT_AssemblyFile : llvm::CGFT_ObjectFile,
+                          objects.back())) {
+            return false;
+        }
+    }
+    if (options.size && !assembly) {
+        CodeSizeReport sizes;
+        for (const auto &object : objects) sizes.add(llvm::StringRef(object.data(), object.size()));
+        sizes.print(llvm::errs());
+    }
+    return writeObjects(objects, options, path);
+}
+
+/**
+ * @brief Writes generated objects (or assembly) to their final destination.
+ * 
+ * A single file is written as is. Several objects, and any object for an
+ * executable, are linked from temporary files, which are removed afterwards.
+ * 
+ * @param objects The generated files.
+ * @param options The command line settings: the output kind and pipe command.
+ * @param path The output path, or "-" for stdout.
+ * @return False if any step failed.
+ */
+bool writeObjects(const std::vector<llvm::SmallVector<char, 0>> &objects, const CompilerOptions &options,
+                  const std::string &path) {
+    Output output;
+    if (options.emit != EmitKind::Executable && objects.size() == 1) {
+        if (!output.open(path, options.pipeCommand)) return false;
+        output.get() << llvm::StringRef(objects[0].data(), objects[0].size());
+        return output.close();
+    }
+
+    // Executables, and objects generated in several partitions, are linked from
+    // temporary object files.
+    std::vector<std::string> objectFiles;
+    bool linked = true;
+    for (const auto &object : objects) {
+        llvm::SmallString<128> objectFile;
+        if (std::error_code error = llvm::sys::fs::createTemporaryFile("toy", "o", objectFile)) {
+            std::cerr << "Could not create a temporary file: " << error.message() << "\n";
+            linked = false;
+            break;
+        }
+        objectFiles.push_back(std::string(objectFile));
+        if (!output.open(objectFiles.back(), "")) {
+            linked = false;
+            break;
+        }
+        output.get() << llvm::StringRef(object.data(), object.size());
+        if (!output.close()) {
+            linked = false;
+            break;
+        }
+    }
+    if (linked) {
+        if (options.emit == EmitKind::Executable) {
+            linked = linkExecutable(objectFiles, path);
+        } else if (options.pipeCommand.empty() && path != "-") {
+            linked = linkRelocatable(objectFiles, path);
+        } else {
+            std::cerr << "Partitioned objects must be written to a file\n";
+            linked = false;
+        }
+    }
+    for (const std::string &objectFile : objectFiles) llvm::sys::fs::remove(objectFile);
+    return linked;
+}
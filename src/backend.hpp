@@ -0,0 +1,199 @@
+#ifndef BACKEND_HPP
+#define BACKEND_HPP
+
+#include "options.hpp"
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/CodeGen.h>
+#include <llvm/Target/TargetOptions.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class Module;
+class TargetMachine;
+}
+class PassReport;
+
+/**
+ * @brief Returns the code generator optimization level for the command line settings.
+ * 
+ * The size levels generate code at the default level, as clang does. With
+ * --fast-codegen the level is None whatever the IR optimization level: LLVM then
+ * selects instructions with FastISel, allocates registers with the fast
+ * allocator and skips the costly machine function passes (scheduling, the
+ * machine-level loop and SSA optimizations).
+ */
+llvm::CodeGenOpt::Level codeGenOptLevel(const CompilerOptions &options);
+
+/**
+ * @brief The CPU and feature string code is generated for.
+ */
+struct TargetSelection {
+    std::string cpu;      ///< CPU name, e.g. "skylake".
+    std::string features; ///< Comma-separated features, e.g. "+avx2,-avx512f"; may be empty.
+};
+
+/**
+ * @brief Resolves the target CPU and features from -mcpu and -mattr.
+ * 
+ * Without -mcpu (or with -mcpu=native) the host CPU is detected together with the
+ * features it actually has, so that, e.g., AVX-512 is not assumed on a CPU model
+ * that has it fused off. A named CPU implies its own features. -mattr entries are
+ * appended last and override both.
+ * 
+ * @param options The command line settings.
+ * @return The selected CPU and features.
+ */
+TargetSelection selectTarget(const CompilerOptions &options);
+
+/**
+ * @brief Checks -mcpu and -mattr before anything is compiled.
+ * 
+ * LLVM only warns about an unknown CPU or feature, once per target machine, and
+ * may then abort when the subtarget it falls back to cannot generate code for the
+ * triple. The CPU is checked against the native target's processor table and each
+ * -mattr entry, which must start with '+' or '-', against its features.
+ * 
+ * @param options The command line settings.
+ * @return False if the CPU or a feature is unknown (reported to std::cerr).
+ */
+bool checkTarget(const CompilerOptions &options);
+
+/**
+ * @brief Returns the code generator options for the command line settings.
+ * 
+ * In --size mode the machine outliner is enabled and runs on every function;
+ * --fast-codegen enables FastISel.
+ * 
+ * @param options The command line settings.
+ * @return The options for a target machine or the JIT.
+ */
+llvm::TargetOptions targetOptions(const CompilerOptions &options);
+
+/**
+ * @brief Creates a target machine for a module's target triple and the selected CPU.
+ * 
+ * Code is position independent so that objects can be linked into the default
+ * (PIE) executables of the system linker.
+ * 
+ * @param module The module whose triple to target.
+ * @param options The command line settings (optimization level, -mcpu, -mattr).
+ * @return The target machine, or null if the target is unknown (reported to std::cerr).
+ */
+std::unique_ptr<llvm::TargetMachine> createTargetMachine(const llvm::Module &module, const CompilerOptions &options);
+
+/**
+ * @brief Generates assembly or object code for a module in memory.
+ * 
+ * @param module The module; its data layout must match the target machine's.
+ * @param machine The target machine to generate code with.
+ * @param fileType Whether to produce assembly or an object file.
+ * @param out Receives the generated file.
+ * @return False if the target cannot emit that kind of file.
+ */
+bool generateCode(llvm::Module &module, llvm::TargetMachine &machine, llvm::CodeGenFileType fileType,
+                  llvm::SmallVectorImpl<char> &out);
+
+/**
+ * @brief Links object files into an executable with the system C compiler driver.
+ * 
+ * The objects are linked against the toy runtime (runtime/print.c, built as
+ * the toy_runtime archive next to the compiler), which provides the output buffer
+ * behind `toy_print`; toy_print itself is already linked into the program. The
+ * driver adds the C library and startup files, which call the program's `main`.
+ * 
+ * @param objectFiles The object files to link.
+ * @param outputFile The executable to create.
+ * @return False if the driver cannot be found or fails.
+ */
+bool linkExecutable(const std::vector<std::string> &objectFiles, const std::string &outputFile);
+
+/**
+ * @brief Combines object files into one relocatable object with the system linker.
+ * 
+ * @param objectFiles The object files to combine.
+ * @param outputFile The object file to create.
+ * @return False if the linker cannot be found or fails.
+ */
+bool linkRelocatable(const std::vector<std::string> &objectFiles, const std::string &outputFile);
+
+/**
+ * @brief Returns true if code generation for these options runs on partitions of the module.
+ * 
+ * That is the case for object and executable output with more than one job. The
+ * module must then be optimized with the PreSplit stage before emitModule.
+ */
+bool splitsCodeGeneration(const CompilerOptions &options);
+
+/**
+ * @brief Splits a module into partitions and compiles them to objects concurrently.
+ * 
+ * The module is divided with llvm::SplitModule, which keeps functions that refer
+ * to the same local symbols together and externalizes the rest. Each partition
+ * is moved into its own LLVMContext and is then optimized with the PostSplit stage
+ * and compiled on a thread of its own, with its own target machine.
+ * 
+ * @param module The module, optimized with the PreSplit stage.
+ * @param options The command line settings; jobs is the number of partitions and threads.
+ * @param objects Receives one object file per partition.
+ * @param report Receives the partitions' pipeline timings and statistics, merged
+ *        once all of them are done; may be null.
+ * @return False if any partition failed.
+ */
+bool generateObjectsInParallel(llvm::Module &module, const CompilerOptions &options,
+                               std::vector<llvm::SmallVector<char, 0>> &objects, PassReport *report = nullptr);
+
+/**
+ * @brief Returns the output path used when -o is not given: the input with a new extension.
+ * 
+ * Executables drop the extension; if that would overwrite the input, a.out is used.
+ * 
+ * @param inputFile The source file.
+ * @param extension The new extension, without the dot; empty for an executable.
+ */
+std::string defaultOutputFile(const std::string &inputFile, llvm::StringRef extension);
+
+/**
+ * @brief Writes a buffer to a file.
+ * 
+ * @param path The file path, or "-" for stdout.
+ * @param contents What to write.
+ * @return False if the file could not be written (reported to std::cerr).
+ */
+bool writeFile(const std::string &path, llvm::StringRef contents);
+
+/**
+ * @brief Writes generated objects (or assembly) to their final destination.
+ * 
+ * A single object or assembly file is written as is, or piped into the --pipe-to
+ * command. An executable is linked from the objects with linkExecutable, and
+ * several objects for --emit=obj are combined with linkRelocatable.
+ * 
+ * @param objects The generated files.
+ * @param options The command line settings: the output kind and pipe command.
+ * @param path The output path, or "-" for stdout.
+ * @return False if any step failed (reported to std::cerr).
+ */
+bool writeObjects(const std::vector<llvm::SmallVector<char, 0>> &objects, const CompilerOptions &options,
+                  const std::string &path);
+
+/**
+ * @brief Writes a module in the form selected on the command line.
+ * 
+ * Textual IR goes to stdout unless an output file is given; bitcode, assembly,
+ * objects and executables are written next to the input unless an output file is
+ * given. Any output but an executable can instead be piped into a command. In
+ * --size mode, the machine code size of each function is printed to stderr
+ * once objects have been generated.
+ * 
+ * @param module The optimized module.
+ * @param options The command line settings.
+ * @param report Receives the timings and statistics of the partitions' pipelines
+ *        when code generation is split; may be null.
+ * @return False if any step failed (reported to std::cerr).
+ */
+bool emitModule(llvm::Module &module, const CompilerOptions &options, PassReport *report = nullptr);
+
+#endif
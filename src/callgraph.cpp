@@ -0,0 +1,224 @@
+#include "callgraph.hpp"
+#include <algorithm>
+
+namespace {
+
+/**
+ * @brief Records the functions called in a subtree.
+ * 
+ * @param node The subtree; may be null.
+ * @param callees Receives each called function once.
+ */
+void collectCallees(const ASTNode *node, std::vector<const FunctionDecl *> &callees) {
+    if (!node) return;
+
+    if (auto *call = dynamic_cast<const FunctionCall *>(node)) {
+        if (call->callee && std::find(callees.begin(), callees.end(), call->callee) == callees.end()) {
+            callees.push_back(call->callee);
+        }
+        for (const auto &arg : call->args) collectCallees(arg.get(), callees);
+    } else if (auto *binary = dynamic_cast<const BinaryExpr *>(node)) {
+        collectCallees(binary->left.get(), callees);
+        collectCallees(binary->right.get(), callees);
+    } else if (auto *block = dynamic_cast<const Block *>(node)) {
+        for (const auto &statement : block->statements) collectCallees(statement.get(), callees);
+    } else if (auto *decl = dynamic_cast<const VarDecl *>(node)) {
+        collectCallees(decl->init.get(), callees);
+    } else if (auto *assign = dynamic_cast<const Assignment *>(node)) {
+        collectCallees(assign->value.get(), callees);
+    } else if (auto *ret = dynamic_cast<const ReturnStatement *>(node)) {
+        collectCallees(ret->value.get(), callees);
+    } else if (auto *ifStmt = dynamic_cast<const IfStatement *>(node)) {
+        collectCallees(ifStmt->condition.get(), callees);
+        collectCallees(ifStmt->thenBranch.get(), callees);
+        collectCallees(ifStmt->elseBranch.get(), callees);
+    } else if (auto *whileStmt = dynamic_cast<const WhileStatement *>(node)) {
+        collectCallees(whileStmt->condition.get(), callees);
+        collectCallees(whileStmt->body.get(), callees);
+    } else if (auto *switchStmt = dynamic_cast<const SwitchStatement *>(node)) {
+        collectCallees(switchStmt->condition.get(), callees);
+        for (const auto &section : switchStmt->cases) collectCallees(section.body.get(), callees);
+    }
+}
+
+/**
+ * @brief Returns the function named `main`, or null.
+ */
+const FunctionDecl *findMain(const Program &program) {
+    for (const auto &function : program.functions) {
+        if (function->name == "main") return function.get();
+    }
+    return nullptr;
+}
+
+} // namespace
+
+/**
+ * @brief Builds the call graph of a resolved program.
+ * 
+ * @param program The program.
+ */
+CallGraph::CallGraph(const Program &program) {
+    functions.reserve(program.functions.size());
+    for (const auto &function : program.functions) {
+        index[function.get()] = static_cast<unsigned>(functions.size());
+        functions.push_back(function.get());
+    }
+
+    edges.resize(functions.size());
+    for (unsigned i = 0; i < functions.size(); i++) {
+        collectCallees(functions[i]->body.get(), edges[i]);
+    }
+    computeSCCs();
+}
+
+/**
+ * @brief Returns the functions called directly by a function, without duplicates.
+ */
+const std::vector<const FunctionDecl *> &CallGraph::callees(const FunctionDecl *function) const {
+    return edges[indexOf(function)];
+}
+
+/**
+ * @brief Finds the SCCs with Tarjan's algorithm and which of them are recursive.
+ * 
+ * The depth-first search keeps an explicit stack so that long call chains in
+ * generated code cannot overflow the native one. Tarjan emits each SCC only after
+ * every SCC reachable from it, which is exactly bottom-up order.
+ */
+void CallGraph::computeSCCs() {
+    const unsigned unvisited = ~0u;
+    unsigned n = static_cast<unsigned>(functions.size());
+    std::vector<unsigned> order(n, unvisited), low(n, 0);
+    std::vector<bool> onStack(n, false);
+    std::vector<unsigned> stack;
+    std::vector<std::pair<unsigned, unsigned>> dfs; // (node, next edge to follow)
+    unsigned counter = 0;
+
+    sccIndex.assign(n, 0);
+    for (unsigned root = 0; root < n; root++) {
+        if (order[root] != unvisited) continue;
+        dfs.push_back({root, 0});
+
+        while (!dfs.empty()) {
+            unsigned node = dfs.back().first;
+            unsigned &next = dfs.back().second;
+
+            if (next == 0 && order[node] == unvisited) {
+                order[node] = low[node] = counter++;
+                stack.push_back(node);
+                onStack[node] = true;
+            }
+
+            if (next < edges[node].size()) {
+                unsigned callee = indexOf(edges[node][next++]);
+                if (order[callee] == unvisited) {
+                    dfs.push_back({callee, 0});
+                } else if (onStack[callee]) {
+                    low[node] = std::min(low[node], order[callee]);
+                }
+                continue;
+            }
+
+            dfs.pop_back();
+            if (!dfs.empty()) {
+                unsigned parent = dfs.back().first;
+                low[parent] = std::min(low[parent], low[node]);
+            }
+            if (low[node] != order[node]) continue;
+
+            // node is the root of an SCC; its members are on top of the stack.
+            unsigned scc = static_cast<unsigned>(components.size());
+            components.emplace_back();
+            unsigned member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                onStack[member] = false;
+                sccIndex[member] = scc;
+                components.back().push_back(functions[member]);
+            } while (member != node);
+            std::reverse(components.back().begin(), components.back().end());
+        }
+    }
+
+    recursive.assign(components.size(), false);
+    for (unsigned scc = 0; scc < components.size(); scc++) {
+        recursive[scc] = components[scc].size() > 1;
+        for (const FunctionDecl *function : components[scc]) {
+            for (const FunctionDecl *callee : edges[indexOf(function)]) {
+                if (sccIndex[indexOf(callee)] == scc) recursive[scc] = true;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Returns the functions reachable from a root, the root included.
+ * 
+ * @param root The function to start from.
+ * @return The reachable functions, in no particular order.
+ */
+std::vector<const FunctionDecl *> CallGraph::reachableFrom(const FunctionDecl *root) const {
+    std::vector<bool> seen(functions.size(), false);
+    std::vector<const FunctionDecl *> result;
+    std::vector<const FunctionDecl *> worklist{root};
+    seen[indexOf(root)] = true;
+
+    while (!worklist.empty()) {
+        const FunctionDecl *function = worklist.back();
+        worklist.pop_back();
+        result.push_back(function);
+        for (const FunctionDecl *callee : callees(function)) {
+            unsigned i = indexOf(callee);
+            if (!seen[i]) {
+                seen[i] = true;
+                worklist.push_back(callee);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Removes the functions that cannot be reached from `main`.
+ * 
+ * @param program The program to prune.
+ * @return The number of functions removed.
+ */
+unsigned stripDeadFunctions(Program &program) {
+    const FunctionDecl *main = findMain(program);
+    if (!main) return 0;
+
+    std::vector<const FunctionDecl *> live = CallGraph(program).reachableFrom(main);
+    std::sort(live.begin(), live.end());
+
+    size_t before = program.functions.size();
+    program.functions.erase(
+        std::remove_if(program.functions.begin(), program.functions.end(),
+                       [&](const std::unique_ptr<FunctionDecl> &function) {
+                           return !std::binary_search(live.begin(), live.end(), function.get());
+                       }),
+        program.functions.end());
+    return static_cast<unsigned>(before - program.functions.size());
+}
+
+/**
+ * @brief Reorders a program's functions bottom-up along the SCCs of its call graph.
+ * 
+ * @param program The program to reorder.
+ */
+void sortFunctionsBottomUp(Program &program) {
+    std::unordered_map<const FunctionDecl *, unsigned> rank;
+    {
+        CallGraph graph(program);
+        unsigned next = 0;
+        for (const auto &scc : graph.sccs()) {
+            for (const FunctionDecl *function : scc) rank[function] = next++;
+        }
+    }
+    std::sort(program.functions.begin(), program.functions.end(),
+              [&](const std::unique_ptr<FunctionDecl> &a, const std::unique_ptr<FunctionDecl> &b) {
+                  return rank[a.get()] < rank[b.get()];
+              });
+}
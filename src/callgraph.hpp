@@ -0,0 +1,88 @@
+#ifndef CALLGRAPH_HPP
+#define CALLGRAPH_HPP
+
+#include "ast.hpp"
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief The static call graph of a program and its strongly connected components.
+ * 
+ * Edges come from the FunctionCall nodes bound by the Resolver; calls to print are
+ * not edges. SCCs are listed bottom-up, every SCC after all SCCs it calls into, so
+ * walking them in order visits callees before callers.
+ */
+class CallGraph {
+public:
+    /**
+     * @brief Builds the call graph of a resolved program.
+     * 
+     * The graph refers to the program's FunctionDecls and must be rebuilt if
+     * functions are added or removed.
+     * 
+     * @param program The program.
+     */
+    explicit CallGraph(const Program &program);
+
+    /**
+     * @brief Returns the functions called directly by a function, without duplicates.
+     */
+    const std::vector<const FunctionDecl *> &callees(const FunctionDecl *function) const;
+
+    /**
+     * @brief Returns the SCCs in bottom-up order.
+     */
+    const std::vector<std::vector<const FunctionDecl *>> &sccs() const { return components; }
+
+    /**
+     * @brief Returns the index in sccs() of the SCC containing a function.
+     */
+    unsigned sccOf(const FunctionDecl *function) const { return sccIndex.at(indexOf(function)); }
+
+    /**
+     * @brief Returns true if an SCC contains a cycle, i.e. its functions may recurse.
+     * 
+     * @param scc An index into sccs().
+     */
+    bool isRecursive(unsigned scc) const { return recursive[scc]; }
+
+    /**
+     * @brief Returns the functions reachable from a root, the root included.
+     * 
+     * @param root The function to start from.
+     * @return The reachable functions, in no particular order.
+     */
+    std::vector<const FunctionDecl *> reachableFrom(const FunctionDecl *root) const;
+
+private:
+    unsigned indexOf(const FunctionDecl *function) const { return index.at(function); }
+    void computeSCCs();
+
+    std::vector<const FunctionDecl *> functions;                 ///< Nodes, in program order.
+    std::unordered_map<const FunctionDecl *, unsigned> index;    ///< Node number of each function.
+    std::vector<std::vector<const FunctionDecl *>> edges;        ///< Direct callees per node.
+    std::vector<std::vector<const FunctionDecl *>> components;   ///< SCCs, bottom-up.
+    std::vector<unsigned> sccIndex;                              ///< SCC of each node.
+    std::vector<bool> recursive;                                 ///< Whether each SCC has a cycle.
+};
+
+/**
+ * @brief Removes the functions that cannot be reached from `main`.
+ * 
+ * A program without `main` is left untouched.
+ * 
+ * @param program The program to prune.
+ * @return The number of functions removed.
+ */
+unsigned stripDeadFunctions(Program &program);
+
+/**
+ * @brief Reorders a program's functions bottom-up along the SCCs of its call graph.
+ * 
+ * Code generation then sees every callee before its callers, except within a cycle.
+ * 
+ * @param program The program to reorder.
+ */
+void sortFunctionsBottomUp(Program &program);
+
+#endif
@@ -0,0 +1,81 @@
+#include "code_size.hpp"
+#include <llvm/Object/ObjectFile.h>
+#include <llvm/Object/SymbolSize.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <iostream>
+
+/**
+ * @brief Adds the functions defined in an object file.
+ * 
+ * Symbol sizes are computed by llvm::object::computeSymbolSizes, which reads them
+ * from the symbol table where the format records them (ELF) and derives them
+ * from the distance to the next symbol otherwise.
+ * 
+ * @param object The object file.
+ */
+void CodeSizeReport::add(const llvm::object::ObjectFile &object) {
+    for (const auto &[symbol, size] : llvm::object::computeSymbolSizes(object)) {
+        llvm::Expected<llvm::object::SymbolRef::Type> type = symbol.getType();
+        llvm::Expected<uint32_t> flags = symbol.getFlags();
+        llvm::Expected<llvm::StringRef> name = symbol.getName();
+        if (!type || !flags || !name) {
+            llvm::consumeError(type.takeError());
+            llvm::consumeError(flags.takeError());
+            llvm::consumeError(name.takeError());
+            continue;
+        }
+        if (*type != llvm::object::SymbolRef::ST_Function || (*flags & llvm::object::SymbolRef::SF_Undefined)) continue;
+        functions.push_back({name->str(), size});
+    }
+}
+
+/**
+ * @brief Adds the functions defined in an object file held in memory.
+ * 
+ * @param buffer The object file's contents.
+ * @return False if the buffer is not a valid object file.
+ */
+bool CodeSizeReport::add(llvm::StringRef buffer) {
+    auto object = llvm::object::ObjectFile::createObjectFile(llvm::MemoryBufferRef(buffer, "object"));
+    if (!object) {
+        std::cerr << "Could not read object file: " << llvm::toString(object.takeError()) << "\n";
+        return false;
+    }
+    add(**object);
+    return true;
+}
+
+/**
+ * @brief Prints the functions, largest first, followed by the total.
+ * 
+ * @param out The stream to print to.
+ */
+void CodeSizeReport::print(llvm::raw_ostream &out) const {
+    std::vector<FunctionSize> sorted(functions);
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const FunctionSize &a, const FunctionSize &b) { return a.bytes > b.bytes; });
+
+    uint64_t total = 0;
+    out << "Code size (bytes of machine code per function):\n";
+    for (const FunctionSize &function : sorted) {
+        out << llvm::format("%10llu", static_cast<unsigned long long>(function.bytes)) << "  " << function.name << "\n";
+        total += function.bytes;
+    }
+    out << llvm::format("%10llu", static_cast<unsigned long long>(total)) << "  total in " << sorted.size()
+        << " functions\n";
+}
+
+/**
+ * @brief Adds the sizes of the functions in an object the JIT has just loaded.
+ * 
+ * The object is the relocatable file the JIT compiled, before linking, so sizes
+ * match what an object file built with the same options would contain.
+ */
+void CodeSizeListener::notifyObjectLoaded(ObjectKey, const llvm::object::ObjectFile &object,
+                                          const llvm::RuntimeDyld::LoadedObjectInfo &) {
+    report.add(object);
+}
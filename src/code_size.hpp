@@ -0,0 +1,81 @@
+#ifndef CODE_SIZE_HPP
+#define CODE_SIZE_HPP
+
+#include <llvm/ExecutionEngine/JITEventListener.h>
+#include <llvm/ADT/StringRef.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+namespace object {
+class ObjectFile;
+}
+}
+
+/**
+ * @brief The bytes of machine code of each function in one or more object files.
+ * 
+ * Sizes come from the object's symbol table, so they include everything the
+ * backend emitted for a function: functions the machine outliner created
+ * (OUTLINED_FUNCTION_n) and thunks left by MergeFunctions appear on their own.
+ */
+class CodeSizeReport {
+public:
+    /**
+     * @brief Adds the functions defined in an object file.
+     * 
+     * @param object The object file.
+     */
+    void add(const llvm::object::ObjectFile &object);
+
+    /**
+     * @brief Adds the functions defined in an object file held in memory.
+     * 
+     * @param buffer The object file's contents.
+     * @return False if the buffer is not a valid object file (reported to std::cerr).
+     */
+    bool add(llvm::StringRef buffer);
+
+    /**
+     * @brief Prints the functions, largest first, followed by the total.
+     * 
+     * @param out The stream to print to.
+     */
+    void print(llvm::raw_ostream &out) const;
+
+private:
+    /**
+     * @brief The size of one function.
+     */
+    struct FunctionSize {
+        std::string name; ///< The symbol name.
+        uint64_t bytes;   ///< Bytes of machine code.
+    };
+
+    std::vector<FunctionSize> functions; ///< Every function added so far.
+};
+
+/**
+ * @brief Collects a CodeSizeReport from the objects a JIT loads.
+ * 
+ * Register it with the JIT's object linking layer before any code is compiled.
+ */
+class CodeSizeListener : public llvm::JITEventListener {
+public:
+    /**
+     * @brief Constructs a listener that adds to a report.
+     * 
+     * @param report The report to fill; must outlive the listener's registration.
+     */
+    explicit CodeSizeListener(CodeSizeReport &report) : report(report) {}
+
+    void notifyObjectLoaded(ObjectKey key, const llvm::object::ObjectFile &object,
+                            const llvm::RuntimeDyld::LoadedObjectInfo &info) override;
+
+private:
+    CodeSizeReport &report; ///< Receives the sizes.
+};
+
+#endif
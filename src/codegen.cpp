@@ -1,16 +1,706 @@
 #include "codegen.hpp"
+#include "arith.hpp"
+#include "toy_runtime.h"
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
 #include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/ExecutorProcessControl.h>
 #include <llvm/ExecutionEngine/Orc/IRCompileLayer.h>
 #include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/Mangling.h>
 #include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
 #include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/BinaryFormat/Dwarf.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Path.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/Error.h>
 #include <llvm/Support/raw_ostream.h>
+#include <chrono>
+#include <iostream>
 
-// ... Existing CodeGen methods ...
+namespace {
+
+/**
+ * @brief Returns true if an expression is cheap enough to evaluate unconditionally.
+ * 
+ * Calls are never speculated, since they may print or not return. Division is
+ * defined for every operand, but costs more than a branch it would replace.
+ * 
+ * @param node The expression.
+ * @param budget Number of nodes the expression may still have; decremented.
+ */
+bool isCheapToSpeculate(const ASTNode *node, unsigned &budget) {
+    if (budget == 0) return false;
+    budget--;
+    if (dynamic_cast<const NumberExpr *>(node) || dynamic_cast<const VariableExpr *>(node)) return true;
+    if (auto *binary = dynamic_cast<const BinaryExpr *>(node)) {
+        return binary->op != BinaryOp::Div && isCheapToSpeculate(binary->left.get(), budget) &&
+               isCheapToSpeculate(binary->right.get(), budget);
+    }
+    return false;
+}
+
+} // namespace
+
+/**
+ * @brief Constructs a CodeGen instance and initializes LLVM structures.
+ * 
+ * The module targets the host by default.
+ * 
+ * @param moduleName The module identifier.
+ */
+CodeGen::CodeGen(const std::string &moduleName) : module(moduleName, context), builder(context) {
+    module.setTargetTriple(llvm::sys::getDefaultTargetTriple());
+}
+
+/**
+ * @brief Selects the CPU and features to generate code for.
+ * 
+ * @param cpu The CPU name.
+ * @param features Comma-separated features; may be empty.
+ * @param dataLayout The data layout of the target machine.
+ */
+void CodeGen::setTarget(const std::string &cpu, const std::string &features, const llvm::DataLayout &dataLayout) {
+    targetCPU = cpu;
+    targetFeatures = features;
+    module.setDataLayout(dataLayout);
+}
+
+/**
+ * @brief Attaches source lines to the generated code as line-tables-only debug info.
+ * 
+ * @param sourceFile The path of the source file.
+ */
+void CodeGen::emitLineTables(const std::string &sourceFile) {
+    debugInfo = std::make_unique<llvm::DIBuilder>(module);
+    debugFile = debugInfo->createFile(llvm::sys::path::filename(sourceFile), llvm::sys::path::parent_path(sourceFile));
+    debugInfo->createCompileUnit(llvm::dwarf::DW_LANG_C, debugFile, "toy_compiler", false, "", 0, llvm::StringRef(),
+                                 llvm::DICompileUnit::LineTablesOnly);
+    module.addModuleFlag(llvm::Module::Warning, "Dwarf Version", 4);
+    module.addModuleFlag(llvm::Module::Warning, "Debug Info Version", llvm::DEBUG_METADATA_VERSION);
+}
+
+/**
+ * @brief Generates LLVM IR for a given AST node.
+ * 
+ * With line tables enabled, each node that has a line moves the current debug
+ * location there; the instructions of its expressions share that location.
+ * 
+ * @param node Pointer to the ASTNode to generate code for.
+ * @return llvm::Value* The generated LLVM IR value, or null for statements.
+ */
+llvm::Value* CodeGen::generate(ASTNode *node) {
+    if (!node || isTerminated()) return nullptr;
+    if (node->line && currentFunction && currentFunction->getSubprogram()) {
+        builder.SetCurrentDebugLocation(llvm::DILocation::get(context, node->line, 0, currentFunction->getSubprogram()));
+    }
+
+    if (auto *program = dynamic_cast<Program *>(node)) {
+        // Every function is declared up front so that calls can refer to functions
+        // defined later and to members of the same recursive cycle.
+        effects.run(*program);
+        auto *intTy = builder.getInt32Ty();
+        for (auto &function : program->functions) {
+            std::vector<llvm::Type *> params(function->params.size(), intTy);
+            auto *type = llvm::FunctionType::get(intTy, params, false);
+            // Functions without a body are defined in another source file.
+            bool external = exportAll || !function->body || function->name == "main";
+            auto linkage = external ? llvm::Function::ExternalLinkage : llvm::Function::InternalLinkage;
+            auto *fn = llvm::Function::Create(type, linkage, function->name, module);
+            for (size_t i = 0; i < function->params.size(); i++) fn->getArg(i)->setName(function->params[i]);
+            addEffectAttributes(*fn, effects.get(function.get()));
+            if (!targetCPU.empty()) fn->addFnAttr("target-cpu", targetCPU);
+            if (!targetFeatures.empty()) fn->addFnAttr("target-features", targetFeatures);
+            if (debugInfo && function->body) {
+                llvm::DISubroutineType *signature =
+                    debugInfo->createSubroutineType(debugInfo->getOrCreateTypeArray(llvm::None));
+                fn->setSubprogram(debugInfo->createFunction(debugFile, function->name, llvm::StringRef(), debugFile,
+                                                            function->line, signature, function->line,
+                                                            llvm::DINode::FlagZero,
+                                                            llvm::DISubprogram::SPFlagDefinition));
+            }
+            functions[function.get()] = fn;
+        }
+        for (auto &function : program->functions) {
+            if (function->body) generateFunction(*function);
+        }
+        if (debugInfo) debugInfo->finalize();
+        valid = !llvm::verifyModule(module, &llvm::errs());
+        if (!valid) {
+            std::cerr << "Generated module is invalid\n";
+        }
+        return nullptr;
+    }
+
+    if (auto *number = dynamic_cast<NumberExpr *>(node)) {
+        return builder.getInt32(number->value);
+    }
+    if (auto *var = dynamic_cast<VariableExpr *>(node)) {
+        return readVariable(var->slot, builder.GetInsertBlock());
+    }
+    if (auto *binary = dynamic_cast<BinaryExpr *>(node)) {
+        return generateBinary(*binary);
+    }
+    if (auto *call = dynamic_cast<FunctionCall *>(node)) {
+        return generateCall(*call);
+    }
+    if (auto *decl = dynamic_cast<VarDecl *>(node)) {
+        llvm::Value *value = decl->init ? generate(decl->init.get()) : builder.getInt32(0);
+        if (value) writeVariable(decl->slot, builder.GetInsertBlock(), value);
+    } else if (auto *assign = dynamic_cast<Assignment *>(node)) {
+        llvm::Value *value = generate(assign->value.get());
+        if (value) writeVariable(assign->slot, builder.GetInsertBlock(), value);
+    } else if (auto *block = dynamic_cast<Block *>(node)) {
+        for (auto &statement : block->statements) generate(statement.get());
+    } else if (auto *ifStmt = dynamic_cast<IfStatement *>(node)) {
+        generateIf(*ifStmt);
+    } else if (auto *whileStmt = dynamic_cast<WhileStatement *>(node)) {
+        generateWhile(*whileStmt);
+    } else if (auto *switchStmt = dynamic_cast<SwitchStatement *>(node)) {
+        generateSwitch(*switchStmt);
+    } else if (dynamic_cast<BreakStatement *>(node)) {
+        builder.CreateBr(breakTargets.back());
+    } else if (auto *ret = dynamic_cast<ReturnStatement *>(node)) {
+        llvm::Value *value = ret->value ? generate(ret->value.get()) : builder.getInt32(0);
+        if (!value) return nullptr;
+        markTailCall(*ret, value);
+        builder.CreateRet(value);
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Generates the body of a function declared by generate(Program).
+ * 
+ * Parameters are the initial definitions of their slots in the entry block, which
+ * has no predecessors and is sealed right away. Falling off the end returns 0.
+ * 
+ * @param function The function to generate.
+ */
+void CodeGen::generateFunction(FunctionDecl &function) {
+    currentFunction = functions[&function];
+    currentDef.clear();
+    sealedBlocks.clear();
+    incompletePhis.clear();
+
+    auto *entry = llvm::BasicBlock::Create(context, "entry", currentFunction);
+    builder.SetInsertPoint(entry);
+    if (llvm::DISubprogram *subprogram = currentFunction->getSubprogram()) {
+        builder.SetCurrentDebugLocation(llvm::DILocation::get(context, function.line, 0, subprogram));
+    } else {
+        builder.SetCurrentDebugLocation(llvm::DebugLoc());
+    }
+    sealBlock(entry);
+    for (size_t i = 0; i < function.params.size(); i++) {
+        writeVariable(static_cast<int>(i), entry, currentFunction->getArg(i));
+    }
+
+    generate(function.body.get());
+    if (!isTerminated()) builder.CreateRet(builder.getInt32(0));
+    currentFunction = nullptr;
+}
+
+/**
+ * @brief Generates a binary operation with the semantics defined in arith.hpp.
+ * 
+ * Addition, subtraction and multiplication wrap, so no nsw/nuw flags are set.
+ * Division by zero yields 0 and INT_MIN / -1 yields INT_MIN; unless the divisor
+ * is a constant for which neither case can occur, the divisor is replaced by 1
+ * in those cases and the quotient for a zero divisor is selected afterwards,
+ * without branches. Shift amounts are reduced modulo 32. Comparisons are
+ * zero-extended to 0 or 1.
+ * 
+ * @param binary The expression.
+ * @return The result value.
+ */
+llvm::Value *CodeGen::generateBinary(BinaryExpr &binary) {
+    if (arith::isShortCircuit(binary.op)) return generateLogical(binary);
+
+    llvm::Value *l = generate(binary.left.get());
+    llvm::Value *r = generate(binary.right.get());
+    if (!l || !r) return nullptr;
+
+    switch (binary.op) {
+        case BinaryOp::Add: return builder.CreateAdd(l, r, "add");
+        case BinaryOp::Sub: return builder.CreateSub(l, r, "sub");
+        case BinaryOp::Mul: return builder.CreateMul(l, r, "mul");
+        case BinaryOp::Div: {
+            auto *divisor = llvm::dyn_cast<llvm::ConstantInt>(r);
+            if (divisor && !divisor->isZero() && !divisor->isMinusOne()) {
+                return builder.CreateSDiv(l, r, "div");
+            }
+            llvm::Value *isZero = builder.CreateICmpEQ(r, builder.getInt32(0));
+            llvm::Value *overflows = builder.CreateAnd(builder.CreateICmpEQ(l, builder.getInt32(INT32_MIN)),
+                                                       builder.CreateICmpEQ(r, builder.getInt32(-1)));
+            llvm::Value *safe = builder.CreateSelect(builder.CreateOr(isZero, overflows), builder.getInt32(1), r);
+            llvm::Value *quotient = builder.CreateSDiv(l, safe, "div");
+            return builder.CreateSelect(isZero, builder.getInt32(0), quotient);
+        }
+        case BinaryOp::Lt: return builder.CreateZExt(builder.CreateICmpSLT(l, r), builder.getInt32Ty(), "lt");
+        case BinaryOp::Le: return builder.CreateZExt(builder.CreateICmpSLE(l, r), builder.getInt32Ty(), "le");
+        case BinaryOp::Gt: return builder.CreateZExt(builder.CreateICmpSGT(l, r), builder.getInt32Ty(), "gt");
+        case BinaryOp::Ge: return builder.CreateZExt(builder.CreateICmpSGE(l, r), builder.getInt32Ty(), "ge");
+        case BinaryOp::Eq: return builder.CreateZExt(builder.CreateICmpEQ(l, r), builder.getInt32Ty(), "eq");
+        case BinaryOp::Ne: return builder.CreateZExt(builder.CreateICmpNE(l, r), builder.getInt32Ty(), "ne");
+        default:
+            break;
+    }
+
+    if (auto *amount = llvm::dyn_cast<llvm::ConstantInt>(r)) {
+        r = builder.getInt32(amount->getZExtValue() & 31);
+    } else {
+        r = builder.CreateAnd(r, builder.getInt32(31));
+    }
+    switch (binary.op) {
+        case BinaryOp::Shl: return builder.CreateShl(l, r, "shl");
+        case BinaryOp::AShr: return builder.CreateAShr(l, r, "ashr");
+        default: return builder.CreateLShr(l, r, "lshr");
+    }
+}
+
+/**
+ * @brief Generates `&&` or `||`.
+ * 
+ * The right operand only runs when the left one does not decide the result. If
+ * it is cheap and cannot have side effects, running it anyway is unobservable, as
+ * no toy operation traps, so both operands are evaluated and combined with a
+ * select: data-dependent conditions then cost no branch that could be
+ * mispredicted. Otherwise the right operand gets a block of its own and the
+ * result is a phi.
+ * 
+ * @param binary The expression.
+ * @return The result, 0 or 1.
+ */
+llvm::Value *CodeGen::generateLogical(BinaryExpr &binary) {
+    bool isAnd = binary.op == BinaryOp::And;
+    llvm::Value *l = generate(binary.left.get());
+    if (!l) return nullptr;
+    llvm::Value *lhs = toCondition(l);
+
+    const unsigned speculationBudget = 8;
+    unsigned budget = speculationBudget;
+    if (isCheapToSpeculate(binary.right.get(), budget)) {
+        llvm::Value *rhs = toCondition(generate(binary.right.get()));
+        llvm::Value *result = isAnd ? builder.CreateSelect(lhs, rhs, builder.getFalse())
+                                    : builder.CreateSelect(lhs, builder.getTrue(), rhs);
+        return builder.CreateZExt(result, builder.getInt32Ty(), isAnd ? "and" : "or");
+    }
+
+    llvm::BasicBlock *lhsBB = builder.GetInsertBlock();
+    auto *rhsBB = llvm::BasicBlock::Create(context, isAnd ? "and.rhs" : "or.rhs", currentFunction);
+    auto *endBB = llvm::BasicBlock::Create(context, isAnd ? "and.end" : "or.end", currentFunction);
+    if (isAnd) {
+        builder.CreateCondBr(lhs, rhsBB, endBB);
+    } else {
+        builder.CreateCondBr(lhs, endBB, rhsBB);
+    }
+
+    sealBlock(rhsBB);
+    builder.SetInsertPoint(rhsBB);
+    llvm::Value *rhs = toCondition(generate(binary.right.get()));
+    llvm::BasicBlock *rhsEndBB = builder.GetInsertBlock();
+    builder.CreateBr(endBB);
+
+    sealBlock(endBB);
+    builder.SetInsertPoint(endBB);
+    llvm::PHINode *result = builder.CreatePHI(builder.getInt1Ty(), 2);
+    result->addIncoming(builder.getInt1(!isAnd), lhsBB);
+    result->addIncoming(rhs, rhsEndBB);
+    return builder.CreateZExt(result, builder.getInt32Ty(), isAnd ? "and" : "or");
+}
+
+/**
+ * @brief Generates a call to a toy function or to the print builtin.
+ * 
+ * print(x) is lowered to a call of the runtime's toy_print (see runtime/toy_runtime.h),
+ * which buffers its output instead of going through printf and stdio's locking,
+ * and evaluates to 0. linkRuntime later supplies toy_print's definition.
+ * 
+ * @param call The call.
+ * @return The call's result.
+ */
+llvm::Value *CodeGen::generateCall(FunctionCall &call) {
+    std::vector<llvm::Value *> args;
+    for (auto &arg : call.args) {
+        llvm::Value *value = generate(arg.get());
+        if (!value) return nullptr;
+        args.push_back(value);
+    }
+
+    if (!call.callee) {
+        llvm::FunctionCallee print = module.getOrInsertFunction(
+            "toy_print", llvm::FunctionType::get(builder.getVoidTy(), {builder.getInt32Ty()}, false));
+        if (auto *fn = llvm::dyn_cast<llvm::Function>(print.getCallee())) fn->addFnAttr(llvm::Attribute::NoUnwind);
+        builder.CreateCall(print, args);
+        return builder.getInt32(0);
+    }
+    return builder.CreateCall(functions[call.callee], args, "call");
+}
+
+/**
+ * @brief Marks a call whose result is returned directly as a tail call.
+ * 
+ * A call to a function with the same signature, which includes every
+ * self-recursive call, becomes `musttail`: the backend must then reuse the
+ * caller's frame (a jump, even at -O0), so recursion in tail position runs in
+ * constant stack space. Calls to functions with a different number of
+ * parameters are marked `tail`, leaving the choice to the backend. All toy
+ * functions use the C calling convention, so the conventions always match.
+ * 
+ * @param ret The return statement.
+ * @param value The generated return value.
+ */
+void CodeGen::markTailCall(ReturnStatement &ret, llvm::Value *value) {
+    auto *call = dynamic_cast<FunctionCall *>(ret.value.get());
+    auto *inst = llvm::dyn_cast<llvm::CallInst>(value);
+    if (!call || !call->callee || !inst || inst->getParent() != builder.GetInsertBlock()) return;
+
+    bool sameSignature = inst->getFunctionType() == currentFunction->getFunctionType();
+    inst->setTailCallKind(sameSignature ? llvm::CallInst::TCK_MustTail : llvm::CallInst::TCK_Tail);
+}
+
+/**
+ * @brief Generates an "if" statement.
+ * 
+ * The branch blocks have a single, already known predecessor and are sealed as
+ * soon as they are created; the merge block is sealed once both branches have been
+ * generated. If both branches end in a return there is no merge block and the
+ * insertion point stays on a terminated block, so following statements are skipped.
+ * 
+ * @param ifStmt The statement.
+ */
+void CodeGen::generateIf(IfStatement &ifStmt) {
+    llvm::Value *condition = generate(ifStmt.condition.get());
+    if (!condition) return;
+
+    auto *thenBB = llvm::BasicBlock::Create(context, "then", currentFunction);
+    auto *mergeBB = llvm::BasicBlock::Create(context, "endif");
+    auto *elseBB = ifStmt.elseBranch ? llvm::BasicBlock::Create(context, "else") : mergeBB;
+    builder.CreateCondBr(toCondition(condition), thenBB, elseBB, branchWeights(ifStmt.hint));
+
+    sealBlock(thenBB);
+    builder.SetInsertPoint(thenBB);
+    generate(ifStmt.thenBranch.get());
+    llvm::BasicBlock *lastBB = builder.GetInsertBlock();
+    if (!isTerminated()) builder.CreateBr(mergeBB);
+
+    if (ifStmt.elseBranch) {
+        elseBB->insertInto(currentFunction);
+        sealBlock(elseBB);
+        builder.SetInsertPoint(elseBB);
+        generate(ifStmt.elseBranch.get());
+        lastBB = builder.GetInsertBlock();
+        if (!isTerminated()) builder.CreateBr(mergeBB);
+    }
+
+    if (llvm::pred_empty(mergeBB)) {
+        delete mergeBB;
+        builder.SetInsertPoint(lastBB);
+        return;
+    }
+    mergeBB->insertInto(currentFunction);
+    sealBlock(mergeBB);
+    builder.SetInsertPoint(mergeBB);
+}
+
+/**
+ * @brief Generates a "while" loop.
+ * 
+ * The loop header stays unsealed while the body is generated, because the back
+ * edge from the latch is not known yet; variables read in the header or body get
+ * incomplete phis that are filled in when the header is sealed. Loop hints are
+ * attached to the back edge, the latch branch LLVM's loop passes look at. The exit
+ * block is sealed last as well, since "break" statements in the body branch to it.
+ * 
+ * @param whileStmt The statement.
+ */
+void CodeGen::generateWhile(WhileStatement &whileStmt) {
+    auto *headerBB = llvm::BasicBlock::Create(context, "while.cond", currentFunction);
+    auto *bodyBB = llvm::BasicBlock::Create(context, "while.body", currentFunction);
+    auto *exitBB = llvm::BasicBlock::Create(context, "while.end", currentFunction);
+    builder.CreateBr(headerBB);
+
+    builder.SetInsertPoint(headerBB);
+    llvm::Value *condition = generate(whileStmt.condition.get());
+    builder.CreateCondBr(toCondition(condition), bodyBB, exitBB, branchWeights(whileStmt.hint));
+
+    sealBlock(bodyBB);
+    builder.SetInsertPoint(bodyBB);
+    breakTargets.push_back(exitBB);
+    generate(whileStmt.body.get());
+    breakTargets.pop_back();
+    if (!isTerminated()) {
+        llvm::BranchInst *latch = builder.CreateBr(headerBB);
+        if (!whileStmt.hints.empty()) latch->setMetadata(llvm::LLVMContext::MD_loop, loopMetadata(whileStmt.hints));
+    }
+
+    sealBlock(headerBB);
+    sealBlock(exitBB);
+    builder.SetInsertPoint(exitBB);
+}
+
+/**
+ * @brief Generates a "switch" statement as a single `switch` instruction.
+ * 
+ * Every case value becomes an edge to its section's block, so instruction
+ * selection is free to lower the dispatch to a jump table, a bit test or a
+ * balanced compare tree instead of a chain of compares. Without a default
+ * section, the default edge goes to the end of the switch. A section's block is
+ * sealed once the section before it is generated, which fixes the fallthrough
+ * edge; "break" branches to the end block, which is sealed last.
+ * 
+ * @param switchStmt The statement.
+ */
+void CodeGen::generateSwitch(SwitchStatement &switchStmt) {
+    llvm::Value *value = generate(switchStmt.condition.get());
+    if (!value) return;
+
+    auto *exitBB = llvm::BasicBlock::Create(context, "switch.end");
+    llvm::BasicBlock *defaultBB = exitBB;
+    std::vector<llvm::BasicBlock *> sectionBBs;
+    unsigned numCases = 0;
+    for (auto &section : switchStmt.cases) {
+        sectionBBs.push_back(llvm::BasicBlock::Create(context, section.isDefault ? "switch.default" : "switch.case"));
+        if (section.isDefault) defaultBB = sectionBBs.back();
+        numCases += static_cast<unsigned>(section.values.size());
+    }
+
+    llvm::SwitchInst *dispatch = builder.CreateSwitch(value, defaultBB, numCases);
+    for (size_t i = 0; i < switchStmt.cases.size(); i++) {
+        for (int caseValue : switchStmt.cases[i].values) dispatch->addCase(builder.getInt32(caseValue), sectionBBs[i]);
+    }
+
+    breakTargets.push_back(exitBB);
+    for (size_t i = 0; i < switchStmt.cases.size(); i++) {
+        if (i > 0 && !isTerminated()) builder.CreateBr(sectionBBs[i]);
+        sectionBBs[i]->insertInto(currentFunction);
+        sealBlock(sectionBBs[i]);
+        builder.SetInsertPoint(sectionBBs[i]);
+        generate(switchStmt.cases[i].body.get());
+    }
+    breakTargets.pop_back();
+    llvm::BasicBlock *lastBB = builder.GetInsertBlock();
+    if (!isTerminated()) builder.CreateBr(exitBB);
+
+    if (llvm::pred_empty(exitBB)) {
+        delete exitBB;
+        builder.SetInsertPoint(lastBB);
+        return;
+    }
+    exitBB->insertInto(currentFunction);
+    sealBlock(exitBB);
+    builder.SetInsertPoint(exitBB);
+}
+
+/**
+ * @brief Returns the `!prof` branch weights for a conditional branch with a hint.
+ * 
+ * The weights are clang's for __builtin_expect: 2000 to 1 in favour of the
+ * expected successor, which is the first (true) one for likely().
+ * 
+ * @param hint The annotation on the condition.
+ * @return The weights, or null if there is no hint.
+ */
+llvm::MDNode *CodeGen::branchWeights(BranchHint hint) {
+    const uint32_t expected = 2000, unexpected = 1;
+    switch (hint) {
+        case BranchHint::Likely: return llvm::MDBuilder(context).createBranchWeights(expected, unexpected);
+        case BranchHint::Unlikely: return llvm::MDBuilder(context).createBranchWeights(unexpected, expected);
+        default: return nullptr;
+    }
+}
+
+/**
+ * @brief Builds the `llvm.loop` metadata for a loop's hints.
+ * 
+ * The encoding follows clang's loop pragmas: a count of 1 disables unrolling
+ * (or interleaving), a vectorization width of 1 disables vectorization, and larger
+ * values force the transformation with that factor.
+ * 
+ * @param hints The hints; must not be empty.
+ * @return A distinct, self-referential loop ID.
+ */
+llvm::MDNode *CodeGen::loopMetadata(const LoopHints &hints) {
+    auto property = [&](const char *name, llvm::Metadata *value = nullptr) -> llvm::Metadata * {
+        llvm::SmallVector<llvm::Metadata *, 2> operands{llvm::MDString::get(context, name)};
+        if (value) operands.push_back(value);
+        return llvm::MDNode::get(context, operands);
+    };
+    auto count = [&](unsigned value) { return llvm::ConstantAsMetadata::get(builder.getInt32(value)); };
+
+    // The first operand refers to the node itself; it is filled in below.
+    llvm::SmallVector<llvm::Metadata *, 4> operands{nullptr};
+    if (hints.unrollCount == 1) {
+        operands.push_back(property("llvm.loop.unroll.disable"));
+    } else if (hints.unrollCount > 1) {
+        operands.push_back(property("llvm.loop.unroll.count", count(hints.unrollCount)));
+    }
+    if (hints.vectorizeWidth > 1) {
+        operands.push_back(property("llvm.loop.vectorize.enable", llvm::ConstantAsMetadata::get(builder.getTrue())));
+    }
+    if (hints.vectorizeWidth) {
+        operands.push_back(property("llvm.loop.vectorize.width", count(hints.vectorizeWidth)));
+    }
+    if (hints.interleaveCount) {
+        operands.push_back(property("llvm.loop.interleave.count", count(hints.interleaveCount)));
+    }
+
+    llvm::MDNode *loopID = llvm::MDNode::getDistinct(context, operands);
+    loopID->replaceOperandWith(0, loopID);
+    return loopID;
+}
+
+/**
+ * @brief Returns true if the current block already ends in a terminator.
+ * 
+ * Code following a return is unreachable and is not generated.
+ */
+bool CodeGen::isTerminated() {
+    llvm::BasicBlock *block = builder.GetInsertBlock();
+    return block && block->getTerminator();
+}
+
+/**
+ * @brief Converts an int condition to an i1 (non-zero is true).
+ * 
+ * A zero-extended comparison is used directly, so conditions like `a < b` need
+ * no second compare, even at -O0.
+ */
+llvm::Value *CodeGen::toCondition(llvm::Value *value) {
+    if (auto *zext = llvm::dyn_cast<llvm::ZExtInst>(value)) {
+        if (zext->getSrcTy()->isIntegerTy(1)) return zext->getOperand(0);
+    }
+    return builder.CreateICmpNE(value, builder.getInt32(0), "cond");
+}
+
+/**
+ * @brief Records the value a slot holds at the end of a block (so far).
+ */
+void CodeGen::writeVariable(int slot, llvm::BasicBlock *block, llvm::Value *value) {
+    currentDef[{block, slot}] = value;
+}
+
+/**
+ * @brief Returns the value of a slot at the current end of a block.
+ */
+llvm::Value *CodeGen::readVariable(int slot, llvm::BasicBlock *block) {
+    auto it = currentDef.find({block, slot});
+    if (it != currentDef.end() && it->second) return it->second;
+    return readVariableRecursive(slot, block);
+}
+
+/**
+ * @brief Looks a slot up in the predecessors of a block with no local definition.
+ * 
+ * In an unsealed block an operandless phi is placed and completed when the block
+ * is sealed. A single predecessor needs no phi. Otherwise a phi is placed and
+ * recorded before its operands are read, which breaks cycles through loops.
+ * A slot read where nothing defines it (only possible on paths where the variable
+ * is not yet declared) reads as 0.
+ */
+llvm::Value *CodeGen::readVariableRecursive(int slot, llvm::BasicBlock *block) {
+    llvm::Value *value;
+    if (!sealedBlocks.count(block)) {
+        auto *phi = block->empty() ? llvm::PHINode::Create(builder.getInt32Ty(), 2, "", block)
+                                   : llvm::PHINode::Create(builder.getInt32Ty(), 2, "", &block->front());
+        incompletePhis[block].push_back({slot, phi});
+        value = phi;
+    } else if (llvm::pred_empty(block)) {
+        value = builder.getInt32(0);
+    } else if (llvm::BasicBlock *pred = block->getSinglePredecessor()) {
+        value = readVariable(slot, pred);
+    } else {
+        auto *phi = block->empty() ? llvm::PHINode::Create(builder.getInt32Ty(), 2, "", block)
+                                   : llvm::PHINode::Create(builder.getInt32Ty(), 2, "", &block->front());
+        writeVariable(slot, block, phi);
+        value = addPhiOperands(slot, phi);
+    }
+    writeVariable(slot, block, value);
+    return value;
+}
+
+/**
+ * @brief Fills a phi with the slot's value from each predecessor.
+ * 
+ * @return The phi, or the value replacing it if it turned out to be trivial.
+ */
+llvm::Value *CodeGen::addPhiOperands(int slot, llvm::PHINode *phi) {
+    llvm::BasicBlock *block = phi->getParent();
+    for (llvm::BasicBlock *pred : llvm::predecessors(block)) {
+        phi->addIncoming(readVariable(slot, pred), pred);
+    }
+    return tryRemoveTrivialPhi(phi);
+}
+
+/**
+ * @brief Removes a phi whose operands are all the same value (or the phi itself).
+ * 
+ * Uses of the phi, including the WeakTrackingVH entries in currentDef, are
+ * redirected to that value. Phis that used the removed one may have become
+ * trivial in turn and are retried.
+ * 
+ * @return The value that replaces the phi, or the phi if it is not trivial.
+ */
+llvm::Value *CodeGen::tryRemoveTrivialPhi(llvm::PHINode *phi) {
+    llvm::Value *same = nullptr;
+    for (llvm::Value *op : phi->incoming_values()) {
+        if (op == same || op == phi) continue;
+        if (same) return phi;
+        same = op;
+    }
+    if (!same) same = builder.getInt32(0);
+
+    std::vector<llvm::PHINode *> users;
+    for (llvm::User *user : phi->users()) {
+        if (auto *userPhi = llvm::dyn_cast<llvm::PHINode>(user); userPhi && userPhi != phi) users.push_back(userPhi);
+    }
+    phi->replaceAllUsesWith(same);
+    phi->eraseFromParent();
+
+    for (llvm::PHINode *user : users) {
+        // A user may already have been removed while handling an earlier one.
+        if (user->getParent()) tryRemoveTrivialPhi(user);
+    }
+    return same;
+}
+
+/**
+ * @brief Marks a block's predecessors as complete and finishes its pending phis.
+ */
+void CodeGen::sealBlock(llvm::BasicBlock *block) {
+    auto pending = incompletePhis.find(block);
+    if (pending != incompletePhis.end()) {
+        auto phis = std::move(pending->second);
+        incompletePhis.erase(pending);
+        for (auto &[slot, phi] : phis) addPhiOperands(slot, phi);
+    }
+    sealedBlocks.insert(block);
+}
+
+/**
+ * @brief Returns the generated module.
+ */
+llvm::Module &CodeGen::getModule() {
+    return module;
+}
+
+/**
+ * @brief Prints the generated LLVM IR to the standard output.
+ */
+void CodeGen::printIR() {
+    module.print(llvm::outs(), nullptr);
+}
+
+int CodeGen::runJIT(llvm::CodeGenOpt::Level optLevel, const llvm::TargetOptions &targetOptions,
+                    llvm::JITEventListener *listener, double *timeToFirstCall) {
+    auto start = std::chrono::steady_clock::now();
 
-void CodeGen::runJIT() {
     // Initialize LLVM targets
     llvm::InitializeNativeTarget();
     llvm::InitializeNativeTargetAsmPrinter();
@@ -21,7 +711,7 @@ void CodeGen::runJIT() {
     if (!EPC) {
         std::cerr << "Failed to create ExecutorProcessControl: "
                   << llvm::toString(EPC.takeError()) << "\n";
-        return;
+        return 1;
     }
 
     // Create ExecutionSession
@@ -31,52 +721,93 @@ void CodeGen::runJIT() {
     auto targetTriple = llvm::sys::getDefaultTargetTriple();
     module.setTargetTriple(targetTriple);
 
-    // Create JITTargetMachineBuilder
-    llvm::orc::JITTargetMachineBuilder JTMB(targetTriple);
+    // Create JITTargetMachineBuilder for the selected CPU and features, or the host's
+    auto JTMBOrErr = llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!JTMBOrErr) {
+        std::cerr << "Failed to detect host: " << llvm::toString(JTMBOrErr.takeError()) << "\n";
+        return 1;
+    }
+    llvm::orc::JITTargetMachineBuilder JTMB = std::move(*JTMBOrErr);
+    if (!targetCPU.empty()) {
+        JTMB.setCPU(targetCPU);
+        JTMB.getFeatures() = llvm::SubtargetFeatures(targetFeatures);
+    }
+    JTMB.setCodeGenOptLevel(optLevel);
+    JTMB.setOptions(targetOptions);
 
     // Create DataLayout
     auto DL = JTMB.getDefaultDataLayoutForTarget();
     if (!DL) {
         std::cerr << "Failed to get DataLayout: " << llvm::toString(DL.takeError()) << "\n";
-        return;
+        return 1;
     }
 
-    // Create IRCompileLayer with ConcurrentIRCompiler
+    // Create IRCompileLayer with ConcurrentIRCompiler on top of an in-memory object linker
+    llvm::orc::RTDyldObjectLinkingLayer objectLayer(
+        execSession, []() { return std::make_unique<llvm::SectionMemoryManager>(); });
+    if (listener) objectLayer.registerJITEventListener(*listener);
     llvm::orc::IRCompileLayer compileLayer(
-        execSession,
-        llvm::orc::ConcurrentIRCompiler(std::move(JTMB)));
+        execSession, objectLayer,
+        std::make_unique<llvm::orc::ConcurrentIRCompiler>(std::move(JTMB)));
 
     // Create main JITDylib and add dynamic library search
     auto &mainJD = execSession.createBareJITDylib("main");
     mainJD.addGenerator(llvm::cantFail(
         llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
-            (*DL)->getGlobalPrefix())));
+            DL->getGlobalPrefix())));
 
-    // Clone the module to transfer ownership to the JIT
-    std::unique_ptr<llvm::Module> clonedModule = llvm::CloneModule(module);
-    llvm::orc::ThreadSafeModule TSM(
-        std::move(clonedModule),
-        std::make_unique<llvm::LLVMContext>());
+    // The runtime is linked into the compiler; bind its entry points directly, since
+    // the compiler's own symbols are not in the dynamic symbol table. toy_print
+    // itself is already part of the module (see linkRuntime).
+    llvm::orc::MangleAndInterner mangle(execSession, *DL);
+    llvm::cantFail(mainJD.define(llvm::orc::absoluteSymbols({
+        {mangle("toy_output"), llvm::JITEvaluatedSymbol(llvm::pointerToJITTargetAddress(&toy_output),
+                                                        llvm::JITSymbolFlags::Exported)},
+        {mangle("toy_make_room"), llvm::JITEvaluatedSymbol(llvm::pointerToJITTargetAddress(&toy_make_room),
+                                                           llvm::JITSymbolFlags::Exported)},
+    })));
+
+    // The JIT takes ownership of its module and context, so hand it a copy of the
+    // module re-read from bitcode into a context of its own
+    llvm::SmallVector<char, 0> bitcode;
+    llvm::raw_svector_ostream bitcodeStream(bitcode);
+    llvm::WriteBitcodeToFile(module, bitcodeStream);
+    auto jitContext = std::make_unique<llvm::LLVMContext>();
+    auto jitModule = llvm::parseBitcodeFile(
+        llvm::MemoryBufferRef(llvm::StringRef(bitcode.data(), bitcode.size()), "toy"), *jitContext);
+    if (!jitModule) {
+        std::cerr << "Failed to copy module for JIT: " << llvm::toString(jitModule.takeError()) << "\n";
+        return 1;
+    }
+    (*jitModule)->setDataLayout(*DL);
+    llvm::orc::ThreadSafeModule TSM(std::move(*jitModule), std::move(jitContext));
 
     // Add the module to the JIT
     if (auto err = compileLayer.add(mainJD, std::move(TSM))) {
         std::cerr << "Failed to add module to JIT: " << llvm::toString(std::move(err)) << "\n";
-        return;
+        return 1;
     }
 
     // Look up the 'main' function
     auto mainSym = execSession.lookup({&mainJD}, "main");
     if (!mainSym) {
         std::cerr << "Failed to lookup 'main': " << llvm::toString(mainSym.takeError()) << "\n";
-        return;
+        return 1;
+    }
+
+    // The lookup compiled the module; everything from here on is the program's own time
+    if (timeToFirstCall) {
+        *timeToFirstCall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
     }
 
     // Cast the symbol to a function pointer and execute
-    auto *mainFunc = (void (*)())(mainSym->getAddress());
-    mainFunc();
+    auto *mainFunc = (int (*)())(mainSym->getAddress());
+    int result = mainFunc();
+    toy_flush();
 
     // Shutdown the execution session
     if (auto err = execSession.endSession()) {
         std::cerr << "Error shutting down session: " << llvm::toString(std::move(err)) << "\n";
     }
-}
\ No newline at end of file
+    return result;
+}
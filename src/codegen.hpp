@@ -2,32 +2,121 @@
 #define CODEGEN_HPP
 
 #include "ast.hpp"
+#include "effects.hpp"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Target/TargetOptions.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class JITEventListener;
+}
 
 /**
  * @class CodeGen
  * @brief A simple LLVM-based code generator for an AST.
+ * 
+ * Locals are never spilled to memory. Each assignment records the new value of the
+ * variable's slot in the current basic block, and reads look the definition up,
+ * inserting phi nodes where control flow merges. This is the on-the-fly SSA
+ * construction of Braun et al., "Simple and Efficient Construction of Static Single
+ * Assignment Form" (CC 2013): a block is sealed once all of its predecessors are
+ * known, phis requested in unsealed blocks are completed when the block is sealed,
+ * and trivial phis are removed as soon as they are found. The IR is in SSA form
+ * even at -O0, with no allocas for mem2reg to promote.
  */
 class CodeGen {
 public:
     /**
      * @brief Constructs a CodeGen instance and initializes LLVM structures.
+     * 
+     * @param moduleName The module identifier; the source file when a program has several.
+     */
+    explicit CodeGen(const std::string &moduleName = "toy");
+
+    /**
+     * @brief Selects the CPU and features to generate code for.
+     * 
+     * Must be called before generating a Program. Every function gets matching
+     * `target-cpu` and `target-features` attributes, which the optimizer's cost
+     * models and the code generator read per function, and the JIT compiles for
+     * the same target. The module takes the target's data layout, so the runtime
+     * linked in before optimization is checked against the real layout. Without a
+     * call, functions carry no target attributes and the JIT targets the detected host.
+     * 
+     * @param cpu The CPU name, e.g. "skylake".
+     * @param features Comma-separated features, e.g. "+avx2,-avx512f"; may be empty.
+     * @param dataLayout The data layout of the target machine.
+     */
+    void setTarget(const std::string &cpu, const std::string &features, const llvm::DataLayout &dataLayout);
+
+    /**
+     * @brief Gives every function external linkage instead of only `main`.
+     * 
+     * Needed when the module is one of several source files, whose functions call
+     * each other. Linking the modules internalizes whatever no other file uses.
+     */
+    void exportFunctions() { exportAll = true; }
+
+    /**
+     * @brief Attaches source lines to the generated code as line-tables-only debug info.
+     * 
+     * Each function gets a DISubprogram and each statement the DILocation of its
+     * line, so that optimization remarks, profilers and debuggers can point back to
+     * the toy source. Must be called before generating a Program.
+     * 
+     * @param sourceFile The path of the source file.
      */
-    CodeGen();
+    void emitLineTables(const std::string &sourceFile);
 
     /**
      * @brief Generates LLVM IR for a given AST node.
      * 
      * This function takes an ASTNode and generates the corresponding LLVM IR representation.
+     * Passing a Program generates the whole module; other nodes are generated into the
+     * function currently being built.
      * 
      * @param node Pointer to the ASTNode to generate code for.
-     * @return llvm::Value* The generated LLVM IR value.
+     * @return llvm::Value* The generated LLVM IR value, or null for statements.
      */
     llvm::Value* generate(ASTNode *node);
 
-    void runJIT();
+    /**
+     * @brief Returns true if the module generated from a Program passed the IR verifier.
+     * 
+     * An invalid module must not reach the optimizer, the JIT or the backend; the
+     * verifier's findings have been printed to stderr.
+     */
+    bool isValid() const { return valid; }
+
+    /**
+     * @brief Returns the generated module, e.g. to optimize it before printing or running it.
+     */
+    llvm::Module &getModule();
+
+    /**
+     * @brief Compiles the module in-process for the selected CPU and runs its `main`.
+     * 
+     * @param optLevel The optimization level of the JIT's instruction selection and
+     *        register allocation; IR-level optimization is up to the caller.
+     * @param targetOptions Code generator options, e.g. to enable the machine outliner.
+     * @param listener Notified of each object the JIT compiles; may be null.
+     * @param timeToFirstCall Receives the seconds from the start of the JIT until `main`
+     *        was compiled and could be called; may be null.
+     * @return The value returned by `main`, or 1 if the JIT failed.
+     */
+    int runJIT(llvm::CodeGenOpt::Level optLevel = llvm::CodeGenOpt::Default,
+               const llvm::TargetOptions &targetOptions = llvm::TargetOptions(),
+               llvm::JITEventListener *listener = nullptr, double *timeToFirstCall = nullptr);
+
     /**
      * @brief Prints the generated LLVM IR to the standard output.
      */
@@ -37,6 +126,44 @@ private:
     llvm::LLVMContext context; ///< The LLVM context for managing global state.
     llvm::Module module; ///< The LLVM module containing the generated code.
     llvm::IRBuilder<> builder; ///< The LLVM IR builder for creating instructions.
+    EffectAnalysis effects; ///< Side effects of the program's functions, emitted as function attributes.
+
+    std::string targetCPU;      ///< CPU for the target-cpu attribute and the JIT; empty for none.
+    std::string targetFeatures; ///< Features for the target-features attribute and the JIT.
+    bool exportAll = false;     ///< Whether every function has external linkage.
+    bool valid = false;         ///< Whether the generated module passed the verifier.
+    std::unique_ptr<llvm::DIBuilder> debugInfo; ///< Builds the line tables, if enabled.
+    llvm::DIFile *debugFile = nullptr;          ///< The source file the line tables refer to.
+
+    llvm::Function *currentFunction = nullptr; ///< The function being generated.
+    llvm::DenseMap<const FunctionDecl *, llvm::Function *> functions; ///< LLVM function of each FunctionDecl.
+    std::vector<llvm::BasicBlock *> breakTargets; ///< Exit blocks of the enclosing loops and switches, innermost last.
+
+    /// Value of each (block, slot) pair, tracked through replaceAllUsesWith when trivial phis are removed.
+    llvm::DenseMap<std::pair<llvm::BasicBlock *, int>, llvm::WeakTrackingVH> currentDef;
+    llvm::SmallPtrSet<llvm::BasicBlock *, 32> sealedBlocks; ///< Blocks whose predecessors are all known.
+    /// Phis created in unsealed blocks, completed by sealBlock.
+    llvm::DenseMap<llvm::BasicBlock *, std::vector<std::pair<int, llvm::PHINode *>>> incompletePhis;
+
+    void generateFunction(FunctionDecl &function);
+    llvm::Value *generateBinary(BinaryExpr &binary);
+    llvm::Value *generateLogical(BinaryExpr &binary);
+    llvm::Value *generateCall(FunctionCall &call);
+    void markTailCall(ReturnStatement &ret, llvm::Value *value);
+    void generateIf(IfStatement &ifStmt);
+    void generateWhile(WhileStatement &whileStmt);
+    void generateSwitch(SwitchStatement &switchStmt);
+    llvm::MDNode *loopMetadata(const LoopHints &hints);
+    llvm::MDNode *branchWeights(BranchHint hint);
+    bool isTerminated();
+    llvm::Value *toCondition(llvm::Value *value);
+
+    void writeVariable(int slot, llvm::BasicBlock *block, llvm::Value *value);
+    llvm::Value *readVariable(int slot, llvm::BasicBlock *block);
+    llvm::Value *readVariableRecursive(int slot, llvm::BasicBlock *block);
+    llvm::Value *addPhiOperands(int slot, llvm::PHINode *phi);
+    llvm::Value *tryRemoveTrivialPhi(llvm::PHINode *phi);
+    void sealBlock(llvm::BasicBlock *block);
 };
 
 #endif
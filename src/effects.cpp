@@ -0,0 +1,138 @@
+#include "effects.hpp"
+#include "callgraph.hpp"
+#include <llvm/IR/Function.h>
+
+namespace {
+
+/**
+ * @brief The facts about a function that can be read directly off its body.
+ */
+struct LocalFacts {
+    bool printsDirectly = false; ///< Contains a call to print.
+    bool hasLoop = false;        ///< Contains a while loop.
+};
+
+/**
+ * @brief Records the print calls and loops in a subtree.
+ * 
+ * @param node The subtree; may be null.
+ * @param facts Receives what was found.
+ */
+void collect(const ASTNode *node, LocalFacts &facts) {
+    if (!node) return;
+
+    if (auto *call = dynamic_cast<const FunctionCall *>(node)) {
+        if (!call->callee) facts.printsDirectly = true;
+        for (const auto &arg : call->args) collect(arg.get(), facts);
+    } else if (auto *binary = dynamic_cast<const BinaryExpr *>(node)) {
+        collect(binary->left.get(), facts);
+        collect(binary->right.get(), facts);
+    } else if (auto *block = dynamic_cast<const Block *>(node)) {
+        for (const auto &statement : block->statements) collect(statement.get(), facts);
+    } else if (auto *decl = dynamic_cast<const VarDecl *>(node)) {
+        collect(decl->init.get(), facts);
+    } else if (auto *assign = dynamic_cast<const Assignment *>(node)) {
+        collect(assign->value.get(), facts);
+    } else if (auto *ret = dynamic_cast<const ReturnStatement *>(node)) {
+        collect(ret->value.get(), facts);
+    } else if (auto *ifStmt = dynamic_cast<const IfStatement *>(node)) {
+        collect(ifStmt->condition.get(), facts);
+        collect(ifStmt->thenBranch.get(), facts);
+        collect(ifStmt->elseBranch.get(), facts);
+    } else if (auto *whileStmt = dynamic_cast<const WhileStatement *>(node)) {
+        facts.hasLoop = true;
+        collect(whileStmt->condition.get(), facts);
+        collect(whileStmt->body.get(), facts);
+    } else if (auto *switchStmt = dynamic_cast<const SwitchStatement *>(node)) {
+        collect(switchStmt->condition.get(), facts);
+        for (const auto &section : switchStmt->cases) collect(section.body.get(), facts);
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Analyzes a resolved program.
+ * 
+ * The SCCs of the call graph are visited bottom-up, so each SCC sees the final
+ * effects of everything it calls in a single pass. All functions of an SCC can
+ * reach each other and therefore share their effects; a recursive SCC may also
+ * recurse forever.
+ * 
+ * @param program The program to analyze.
+ */
+void EffectAnalysis::run(const Program &program) {
+    effects.clear();
+
+    CallGraph graph(program);
+    for (unsigned scc = 0; scc < graph.sccs().size(); scc++) {
+        FunctionEffects fx;
+        fx.recurses = graph.isRecursive(scc);
+        fx.mayNotReturn = fx.recurses;
+
+        for (const FunctionDecl *function : graph.sccs()[scc]) {
+            if (!function->body) {
+                // Defined in another source file: it may do anything, including call back.
+                fx.callsPrint = fx.mayNotReturn = fx.recurses = true;
+                continue;
+            }
+            LocalFacts facts;
+            collect(function->body.get(), facts);
+            fx.callsPrint |= facts.printsDirectly;
+            fx.mayNotReturn |= facts.hasLoop;
+
+            for (const FunctionDecl *callee : graph.callees(function)) {
+                if (graph.sccOf(callee) == scc) continue;
+                const FunctionEffects &cfx = effects[callee];
+                fx.callsPrint |= cfx.callsPrint;
+                fx.mayNotReturn |= cfx.mayNotReturn;
+                fx.recurses |= !callee->body;
+            }
+        }
+        fx.readsMemory = fx.callsPrint;
+        fx.writesMemory = fx.callsPrint;
+
+        for (const FunctionDecl *function : graph.sccs()[scc]) effects[function] = fx;
+    }
+}
+
+/**
+ * @brief Returns the effects of an analyzed function.
+ * 
+ * @param function A function of the analyzed program.
+ * @return Its effects; conservative defaults for unknown functions.
+ */
+const FunctionEffects &EffectAnalysis::get(const FunctionDecl *function) const {
+    static const FunctionEffects unknown = [] {
+        FunctionEffects fx;
+        fx.callsPrint = fx.readsMemory = fx.writesMemory = fx.mayNotReturn = fx.recurses = true;
+        return fx;
+    }();
+    auto it = effects.find(function);
+    return it == effects.end() ? unknown : it->second;
+}
+
+/**
+ * @brief Adds the LLVM function attributes implied by a function's effects.
+ * 
+ * @param function The LLVM function to annotate.
+ * @param effects The function's inferred effects.
+ */
+void addEffectAttributes(llvm::Function &function, const FunctionEffects &effects) {
+    function.addFnAttr(llvm::Attribute::NoUnwind);
+
+    if (!effects.readsMemory && !effects.writesMemory) {
+        function.addFnAttr(llvm::Attribute::ReadNone);
+    } else if (!effects.writesMemory) {
+        function.addFnAttr(llvm::Attribute::ReadOnly);
+    }
+    if (!effects.mayNotReturn) {
+        function.addFnAttr(llvm::Attribute::WillReturn);
+    }
+    if (!effects.recurses) {
+        function.addFnAttr(llvm::Attribute::NoRecurse);
+    }
+    if (effects.isPure() && !effects.mayNotReturn) {
+        function.addFnAttr(llvm::Attribute::Speculatable);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef EFFECTS_HPP
+#define EFFECTS_HPP
+
+#include "ast.hpp"
+#include <unordered_map>
+
+namespace llvm {
+class Function;
+}
+
+/**
+ * @brief What calling a function may do besides computing its result.
+ * 
+ * Locals never live in memory, so the only memory a toy function touches is the
+ * I/O state behind print; reading and writing memory therefore follow from
+ * calling print, directly or through a callee.
+ */
+struct FunctionEffects {
+    bool callsPrint = false;   ///< Prints, directly or through a callee.
+    bool readsMemory = false;  ///< May read memory visible to the caller.
+    bool writesMemory = false; ///< May write memory visible to the caller.
+    bool mayNotReturn = false; ///< Contains a loop or recursion, or calls something that does.
+    bool recurses = false;     ///< May call itself, directly or through other functions.
+
+    /**
+     * @brief Returns true if a call can be removed when its result is unused.
+     */
+    bool isPure() const { return !readsMemory && !writesMemory; }
+};
+
+/**
+ * @brief Infers FunctionEffects for every function of a program.
+ * 
+ * Direct facts (calls to print, loops) are gathered from each body and then
+ * propagated from callees to callers along the SCCs of the CallGraph.
+ */
+class EffectAnalysis {
+public:
+    /**
+     * @brief Analyzes a resolved program.
+     * 
+     * @param program The program to analyze.
+     */
+    void run(const Program &program);
+
+    /**
+     * @brief Returns the effects of an analyzed function.
+     * 
+     * @param function A function of the analyzed program.
+     * @return Its effects; conservative defaults for unknown functions.
+     */
+    const FunctionEffects &get(const FunctionDecl *function) const;
+
+private:
+    std::unordered_map<const FunctionDecl *, FunctionEffects> effects; ///< Results per function.
+};
+
+/**
+ * @brief Adds the LLVM function attributes implied by a function's effects.
+ * 
+ * Every toy function is `nounwind`. Functions without memory effects get
+ * `readnone`; `willreturn` and `norecurse` follow from the analysis, and pure
+ * functions that always return are also `speculatable`, which is sound because
+ * no toy operation has undefined behavior (see arith.hpp).
+ * 
+ * @param function The LLVM function to annotate.
+ * @param effects The function's inferred effects.
+ */
+void addEffectAttributes(llvm::Function &function, const FunctionEffects &effects);
+
+#endif
@@ -0,0 +1,157 @@
+#include "interpreter.hpp"
+#include "arith.hpp"
+#include <algorithm>
+
+namespace {
+
+/**
+ * @brief Thrown to unwind an evaluation that hit one of the interpreter's limits.
+ */
+struct EvaluationAborted {};
+
+} // namespace
+
+/**
+ * @brief Constructs an interpreter with the given limits.
+ * 
+ * @param stepBudget Maximum number of statements and expressions evaluated per call.
+ * @param maxDepth Maximum nesting of calls.
+ */
+Interpreter::Interpreter(unsigned long stepBudget, unsigned maxDepth)
+    : stepBudget(stepBudget), maxDepth(maxDepth) {}
+
+/**
+ * @brief Evaluates a call to a function with constant arguments.
+ * 
+ * @param function The function to call.
+ * @param args The argument values.
+ * @param result Receives the return value on success.
+ * @return False if the budget or depth limit was exceeded.
+ */
+bool Interpreter::call(const FunctionDecl &function, const std::vector<int> &args, int &result) {
+    steps = 0;
+    depth = 0;
+    try {
+        result = invoke(function, args);
+        return true;
+    } catch (const EvaluationAborted &) {
+        return false;
+    }
+}
+
+/**
+ * @brief Runs a function body in a fresh frame.
+ * 
+ * Parameters occupy the first slots; all other locals start out as zero. Falling
+ * off the end of a function returns 0.
+ * 
+ * @param function The function to run.
+ * @param args The argument values.
+ * @return The function's return value.
+ */
+int Interpreter::invoke(const FunctionDecl &function, std::vector<int> args) {
+    if (!function.body) throw EvaluationAborted(); // defined in another source file
+    if (++depth > maxDepth) throw EvaluationAborted();
+
+    std::vector<int> frame = std::move(args);
+    frame.resize(function.numLocals, 0);
+
+    int returned = 0;
+    execute(function.body.get(), frame, returned);
+    depth--;
+    return returned;
+}
+
+/**
+ * @brief Executes a statement.
+ * 
+ * @param node The statement; may be null for an absent else branch.
+ * @param frame The current function's slots.
+ * @param returned Receives the value of an executed "return".
+ * @return Flow::Return if a "return" was executed, Flow::Break if a "break" was
+ *         executed that the statement does not enclose.
+ */
+Interpreter::Flow Interpreter::execute(const ASTNode *node, std::vector<int> &frame, int &returned) {
+    if (!node) return Flow::Normal;
+    step();
+
+    if (auto *block = dynamic_cast<const Block *>(node)) {
+        for (const auto &statement : block->statements) {
+            Flow flow = execute(statement.get(), frame, returned);
+            if (flow != Flow::Normal) return flow;
+        }
+    } else if (auto *decl = dynamic_cast<const VarDecl *>(node)) {
+        frame[decl->slot] = decl->init ? evaluate(decl->init.get(), frame) : 0;
+    } else if (auto *assign = dynamic_cast<const Assignment *>(node)) {
+        frame[assign->slot] = evaluate(assign->value.get(), frame);
+    } else if (auto *ifStmt = dynamic_cast<const IfStatement *>(node)) {
+        const ASTNode *taken = evaluate(ifStmt->condition.get(), frame) ? ifStmt->thenBranch.get()
+                                                                          : ifStmt->elseBranch.get();
+        return execute(taken, frame, returned);
+    } else if (auto *whileStmt = dynamic_cast<const WhileStatement *>(node)) {
+        while (evaluate(whileStmt->condition.get(), frame)) {
+            Flow flow = execute(whileStmt->body.get(), frame, returned);
+            if (flow == Flow::Return) return Flow::Return;
+            if (flow == Flow::Break) break;
+        }
+    } else if (auto *switchStmt = dynamic_cast<const SwitchStatement *>(node)) {
+        int value = evaluate(switchStmt->condition.get(), frame);
+        auto &cases = switchStmt->cases;
+        auto entry = std::find_if(cases.begin(), cases.end(), [&](const SwitchCase &section) {
+            return std::find(section.values.begin(), section.values.end(), value) != section.values.end();
+        });
+        if (entry == cases.end()) {
+            entry = std::find_if(cases.begin(), cases.end(), [](const SwitchCase &section) { return section.isDefault; });
+        }
+        // Sections fall through into the next one.
+        for (; entry != cases.end(); ++entry) {
+            Flow flow = execute(entry->body.get(), frame, returned);
+            if (flow == Flow::Return) return Flow::Return;
+            if (flow == Flow::Break) break;
+        }
+    } else if (dynamic_cast<const BreakStatement *>(node)) {
+        return Flow::Break;
+    } else if (auto *ret = dynamic_cast<const ReturnStatement *>(node)) {
+        returned = ret->value ? evaluate(ret->value.get(), frame) : 0;
+        return Flow::Return;
+    } else {
+        evaluate(node, frame);
+    }
+    return Flow::Normal;
+}
+
+/**
+ * @brief Evaluates an expression.
+ * 
+ * @param node The expression.
+ * @param frame The current function's slots.
+ * @return The expression's value.
+ */
+int Interpreter::evaluate(const ASTNode *node, std::vector<int> &frame) {
+    step();
+
+    if (auto *number = dynamic_cast<const NumberExpr *>(node)) return number->value;
+    if (auto *var = dynamic_cast<const VariableExpr *>(node)) return frame[var->slot];
+    if (auto *binary = dynamic_cast<const BinaryExpr *>(node)) {
+        int l = evaluate(binary->left.get(), frame);
+        if (binary->op == BinaryOp::And && !l) return 0;
+        if (binary->op == BinaryOp::Or && l) return 1;
+        int r = evaluate(binary->right.get(), frame);
+        return arith::evaluate(binary->op, l, r);
+    }
+    if (auto *call = dynamic_cast<const FunctionCall *>(node)) {
+        if (!call->callee) throw EvaluationAborted(); // print has an effect we cannot replay
+        std::vector<int> args;
+        args.reserve(call->args.size());
+        for (const auto &arg : call->args) args.push_back(evaluate(arg.get(), frame));
+        return invoke(*call->callee, std::move(args));
+    }
+    throw EvaluationAborted();
+}
+
+/**
+ * @brief Charges one step against the budget.
+ */
+void Interpreter::step() {
+    if (++steps > stepBudget) throw EvaluationAborted();
+}
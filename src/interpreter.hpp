@@ -0,0 +1,53 @@
+#ifndef INTERPRETER_HPP
+#define INTERPRETER_HPP
+
+#include "ast.hpp"
+#include <vector>
+
+/**
+ * @brief A tree-walking interpreter for evaluating pure code at compile time.
+ * 
+ * Evaluation follows the semantics in arith.hpp, so its results match what the
+ * generated code computes. Each call is limited to a number of evaluation steps and
+ * a maximum call depth; exceeding either abandons the evaluation.
+ */
+class Interpreter {
+public:
+    /**
+     * @brief Constructs an interpreter with the given limits.
+     * 
+     * @param stepBudget Maximum number of statements and expressions evaluated per call.
+     * @param maxDepth Maximum nesting of calls.
+     */
+    explicit Interpreter(unsigned long stepBudget, unsigned maxDepth = 256);
+
+    /**
+     * @brief Evaluates a call to a function with constant arguments.
+     * 
+     * The function must be pure; a call to print aborts the evaluation.
+     * 
+     * @param function The function to call.
+     * @param args The argument values.
+     * @param result Receives the return value on success.
+     * @return False if the budget or depth limit was exceeded.
+     */
+    bool call(const FunctionDecl &function, const std::vector<int> &args, int &result);
+
+private:
+    /**
+     * @brief How control leaves a statement.
+     */
+    enum class Flow { Normal, Break, Return };
+
+    int invoke(const FunctionDecl &function, std::vector<int> args);
+    Flow execute(const ASTNode *node, std::vector<int> &frame, int &returned);
+    int evaluate(const ASTNode *node, std::vector<int> &frame);
+    void step();
+
+    unsigned long stepBudget; ///< Steps allowed per top-level call.
+    unsigned maxDepth;        ///< Maximum call nesting.
+    unsigned long steps = 0;  ///< Steps taken in the current top-level call.
+    unsigned depth = 0;       ///< Current call nesting.
+};
+
+#endif
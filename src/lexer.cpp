@@ -1,5 +1,6 @@
 #include "lexer.hpp"
 #include <cctype>
+#include <stdexcept>
 
 /**
  * @brief Constructs a Lexer object that processes the given source string.
@@ -19,11 +20,34 @@ Lexer::Lexer(const std::string &src) : source(src), pos(0) {}
  * 
  * @return A Token object representing the next token in the source code.
  *         If the end of the source string is reached, returns a token of type END.
+ * @throws std::runtime_error If a character cannot start any token.
  */
 Token Lexer::getNextToken() {
-    // Skip any whitespace characters.
-    while (pos < source.length() && isspace(source[pos])) pos++;
+    // Skip whitespace and line comments, counting lines.
+    while (pos < source.length()) {
+        if (isspace(source[pos])) {
+            if (source[pos] == '\n') line++;
+            pos++;
+        } else if (source.compare(pos, 2, "//") == 0) {
+            while (pos < source.length() && source[pos] != '\n') pos++;
+        } else {
+            break;
+        }
+    }
+
+    // Tokens never span lines.
+    Token token = scanToken();
+    token.line = line;
+    return token;
+}
 
+/**
+ * @brief Scans the token at the current position, which is not whitespace.
+ * 
+ * @return The token, without its line.
+ * @throws std::runtime_error If the character cannot start any token.
+ */
+Token Lexer::scanToken() {
     // If we have reached the end of the source, return an END token.
     if (pos >= source.length()) return {TokenType::END, ""};
 
@@ -32,35 +56,81 @@ Token Lexer::getNextToken() {
     // If the current character is a digit, it represents a number.
     if (isdigit(current)) {
         std::string num;
-        while (isdigit(source[pos])) num += source[pos++];
+        while (pos < source.length() && isdigit(source[pos])) num += source[pos++];
         return {TokenType::NUMBER, num};
     }
 
     // If the current character is a letter, it may represent a keyword or identifier.
-    if (isalpha(current)) {
+    if (isalpha(current) || current == '_') {
         std::string ident;
-        while (isalnum(source[pos])) ident += source[pos++];
+        while (pos < source.length() && (isalnum(source[pos]) || source[pos] == '_')) ident += source[pos++];
         if (ident == "int") return {TokenType::INT, ident};
         if (ident == "return") return {TokenType::RETURN, ident};
+        if (ident == "if") return {TokenType::IF, ident};
+        if (ident == "else") return {TokenType::ELSE, ident};
+        if (ident == "while") return {TokenType::WHILE, ident};
+        if (ident == "switch") return {TokenType::SWITCH, ident};
+        if (ident == "case") return {TokenType::CASE, ident};
+        if (ident == "default") return {TokenType::DEFAULT, ident};
+        if (ident == "break") return {TokenType::BREAK, ident};
         return {TokenType::IDENTIFIER, ident};
     }
 
+    // '#pragma' introduces a hint for the loop that follows.
+    if (source.compare(pos, 7, "#pragma") == 0 && (pos + 7 == source.length() || !isalnum(source[pos + 7]))) {
+        pos += 7;
+        return {TokenType::PRAGMA, "#pragma"};
+    }
+
+    // Two-character operators; '=' alone is an assignment, '!' alone a negation.
+    static const char *const twoCharOperators[] = {"<=", ">=", "==", "!=", "&&", "||"};
+    for (const char *op : twoCharOperators) {
+        if (source.compare(pos, 2, op) == 0) {
+            pos += 2;
+            return {TokenType::OPERATOR, op};
+        }
+    }
+
     // Handle various operators and symbols.
+    pos++;
     switch (current) {
-        case '+': case '-': case '*': case '/': 
-            return {TokenType::OPERATOR, std::string(1, source[pos++])};
+        case '+': case '-': case '*': case '/': case '<': case '>': case '!':
+            return {TokenType::OPERATOR, std::string(1, current)};
+        case '=':
+            return {TokenType::ASSIGN, "="};
+        case ',':
+            return {TokenType::COMMA, ","};
         case '(': 
-            return {TokenType::PAREN_OPEN, "("}; pos++;
+            return {TokenType::PAREN_OPEN, "("};
         case ')': 
-            return {TokenType::PAREN_CLOSE, ")"}; pos++;
+            return {TokenType::PAREN_CLOSE, ")"};
         case '{': 
-            return {TokenType::BRACE_OPEN, "{"}; pos++;
+            return {TokenType::BRACE_OPEN, "{"};
         case '}': 
-            return {TokenType::BRACE_CLOSE, "}"}; pos++;
+            return {TokenType::BRACE_CLOSE, "}"};
         case ';': 
-            return {TokenType::SEMICOLON, ";"}; pos++;
+            return {TokenType::SEMICOLON, ";"};
+        case ':':
+            return {TokenType::COLON, ":"};
     }
 
-    // If no valid token is found, return END token.
-    return {TokenType::END, ""};
+    // Anything else is not part of the language.
+    throw std::runtime_error(std::string("unexpected character '") + current + "' on line " + std::to_string(line));
+}
+
+/**
+ * @brief Returns the next token without consuming it.
+ * 
+ * The lexer is purely positional, so peeking is a matter of scanning the next token
+ * and restoring the position afterwards.
+ * 
+ * @return The token that the next call to getNextToken() will return.
+ */
+Token Lexer::peekToken() {
+    size_t saved = pos;
+    unsigned savedLine = line;
+    Token token = getNextToken();
+    pos = saved;
+    line = savedLine;
+    return token;
 }
@@ -16,26 +16,35 @@ enum class TokenType {
     IF,          /**< Represents the 'if' keyword */
     ELSE,        /**< Represents the 'else' keyword */
     WHILE,       /**< Represents the 'while' keyword */
+    SWITCH,      /**< Represents the 'switch' keyword */
+    CASE,        /**< Represents the 'case' keyword */
+    DEFAULT,     /**< Represents the 'default' keyword */
+    BREAK,       /**< Represents the 'break' keyword */
+    PRAGMA,      /**< Represents the '#pragma' directive introducing a loop hint */
     IDENTIFIER,  /**< Represents an identifier (variable or function name) */
     NUMBER,      /**< Represents a number */
-    OPERATOR,    /**< Represents an operator (+, -, *, /) */
+    OPERATOR,    /**< Represents an operator (+ - * / < <= > >= == != && || !) */
+    ASSIGN,      /**< Represents the assignment operator '=' */
+    COMMA,       /**< Represents a comma ',' separating arguments and parameters */
     PAREN_OPEN,  /**< Represents an open parenthesis '(' */
     PAREN_CLOSE, /**< Represents a close parenthesis ')' */
     BRACE_OPEN,  /**< Represents an open brace '{' */
     BRACE_CLOSE, /**< Represents a close brace '}' */
     SEMICOLON,   /**< Represents a semicolon ';' */
+    COLON,       /**< Represents a colon ':' ending a case label */
     END          /**< Represents the end of the input */
 };
 
 /**
  * @brief Represents a single token.
  * 
- * A token consists of a type (from the TokenType enum) and its value (a string
- * representation of the token).
+ * A token consists of a type (from the TokenType enum), its value (a string
+ * representation of the token) and the line it is on.
  */
 struct Token {
     TokenType type;  /**< The type of the token */
     std::string value; /**< The value of the token as a string */
+    unsigned line = 0; /**< The line the token is on, counting from 1 */
 };
 
 /**
@@ -64,12 +73,26 @@ public:
      * the next token. If the end of the source code is reached, an END token is returned.
      * 
      * @return A Token representing the next token in the source code.
+     * @throws std::runtime_error If a character cannot start any token.
      */
     Token getNextToken();
 
+    /**
+     * @brief Returns the next token without consuming it.
+     * 
+     * Used by the parser where a single token of lookahead past the current one is
+     * needed, e.g. to tell an assignment `x = ...` from an expression starting with `x`.
+     * 
+     * @return The token that the next call to getNextToken() will return.
+     */
+    Token peekToken();
+
 private:
+    Token scanToken();
+
     std::string source; /**< The source code to tokenize */
     size_t pos = 0;     /**< The current position in the source code */
+    unsigned line = 1;  /**< The line of the current position */
 };
 
 #endif
@@ -1,56 +1,257 @@
 #include <fstream>
 #include <iostream>
+#include <unordered_map>
 #include "lexer.hpp"
 #include "parser.hpp"
+#include "resolver.hpp"
+#include "ast_passes.hpp"
+#include "callgraph.hpp"
+#include "options.hpp"
+#include "optimizer.hpp"
+#include "backend.hpp"
+#include "pass_report.hpp"
+#include "code_size.hpp"
+#include "thin_link.hpp"
+#include "runtime_link.hpp"
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
 #include "codegen.hpp"
 
+/**
+ * @brief Reads and parses one source file.
+ * 
+ * @param path The source file.
+ * @return The AST, or null if the file cannot be read or parsed (reported to std::cerr).
+ */
+static std::unique_ptr<Program> parseFile(const std::string &path) {
+    // Open the source file for reading
+    std::ifstream inputFile(path);
+    if (!inputFile) {
+        std::cerr << "Could not open file " << path << std::endl;
+        return nullptr;
+    }
+
+    // Read the entire source file into a string
+    std::string source((std::istreambuf_iterator<char>(inputFile)), std::istreambuf_iterator<char>());
+
+    // Create a lexer and parser for tokenizing and parsing the source code
+    Lexer lexer(source);
+    Parser parser(lexer);
+
+    // Parse the source code into an abstract syntax tree (AST)
+    try {
+        return parser.parseProgram();
+    } catch (const std::exception &e) {
+        std::cerr << path << ": error: " << e.what() << "\n";
+        return nullptr;
+    }
+}
+
+/**
+ * @brief Binds every name in a parsed program and simplifies it before IR generation.
+ * 
+ * @param program The program.
+ * @param path The program's source file, for error messages.
+ * @param options The command line settings.
+ * @param externals Functions the program's other source files define; may be null.
+ * @return False if name resolution failed (reported to std::cerr).
+ */
+static bool resolveAndSimplify(Program &program, const std::string &path, const CompilerOptions &options,
+                               const ExternalFunctions *externals) {
+    // Bind variables and calls to their declarations
+    Resolver resolver(path, externals);
+    if (!resolver.resolve(program)) {
+        return false;
+    }
+
+    // Fold constants and simplify arithmetic before any IR is built. Evaluating
+    // pure calls with constant arguments exposes more constants to fold.
+    ConstantFolder().run(program);
+    if (CallEvaluator(options.evalBudget).run(program) > 0) {
+        ConstantFolder().run(program);
+    }
+    return true;
+}
+
+/**
+ * @brief Writes the JSON pass report to --report-file, or to stderr.
+ * 
+ * @return False if the report file could not be opened.
+ */
+static bool writeReport(PassReport &report, const CompilerOptions &options) {
+    if (options.reportFile.empty()) {
+        report.writeJSON(llvm::errs());
+        return true;
+    }
+    std::error_code error;
+    llvm::raw_fd_ostream out(options.reportFile, error);
+    if (error) {
+        std::cerr << "Could not open " << options.reportFile << ": " << error.message() << "\n";
+        return false;
+    }
+    report.writeJSON(out);
+    return true;
+}
+
+/**
+ * @brief Compiles a program of several source files ThinLTO-style.
+ * 
+ * Each file is resolved against the functions the others define, generated into
+ * a module of its own with every function exported, linked with its own copy of
+ * the runtime functions it calls, optimized with the ThinLTO pre-link pipeline
+ * and summarized. emitThinLinked does the rest.
+ * 
+ * @param options The command line settings.
+ * @param report Receives the pre- and post-link pipelines' timings and statistics; may be null.
+ * @return 0 on success, or 1 if there was an error.
+ */
+static int compileSeparately(const CompilerOptions &options, PassReport *report) {
+    std::vector<std::unique_ptr<Program>> programs;
+    for (const std::string &path : options.inputFiles) {
+        programs.push_back(parseFile(path));
+        if (!programs.back()) return 1;
+    }
+
+    // Every file may call the functions the other files define
+    ExternalFunctions defined;
+    std::unordered_map<std::string, const std::string *> definedIn;
+    for (size_t i = 0; i < programs.size(); i++) {
+        for (const auto &function : programs[i]->functions) {
+            auto [first, inserted] = definedIn.emplace(function->name, &options.inputFiles[i]);
+            if (!inserted) {
+                std::cerr << options.inputFiles[i] << ": error: function '" << function->name
+                          << "' is also defined in " << *first->second << "\n";
+                return 1;
+            }
+            defined[function->name] = function->params.size();
+        }
+    }
+
+    TargetSelection target = selectTarget(options);
+    std::vector<SummarizedModule> modules;
+    for (size_t i = 0; i < programs.size(); i++) {
+        ExternalFunctions externals = defined;
+        for (const auto &function : programs[i]->functions) externals.erase(function->name);
+        if (!resolveAndSimplify(*programs[i], options.inputFiles[i], options, &externals)) return 1;
+
+        // Functions are not stripped here: other files may call any of them, and the
+        // thin link removes the ones nothing reaches from main
+        sortFunctionsBottomUp(*programs[i]);
+
+        CodeGen codeGen(options.inputFiles[i]);
+        std::unique_ptr<llvm::TargetMachine> machine = createTargetMachine(codeGen.getModule(), options);
+        if (!machine) return 1;
+        codeGen.setTarget(target.cpu, target.features, machine->createDataLayout());
+        codeGen.exportFunctions();
+        if (!options.remarksFile.empty()) codeGen.emitLineTables(options.inputFiles[i]);
+        codeGen.generate(programs[i].get());
+        if (!codeGen.isValid() || !linkRuntime(codeGen.getModule()) ||
+            !Optimizer(options, report, PipelineStage::PreSplit).run(codeGen.getModule())) {
+            return 1;
+        }
+        modules.push_back({options.inputFiles[i], {}});
+        writeSummarizedBitcode(codeGen.getModule(), modules.back().bitcode);
+    }
+    if (!emitThinLinked(modules, options, report)) {
+        return 1;
+    }
+    // Written last, once the post-link pipelines have added their passes
+    if (report && !writeReport(*report, options)) {
+        return 1;
+    }
+    return 0;
+}
+
 /**
  * @brief The main entry point for the compiler program.
  * 
  * This program takes a source file as input, tokenizes it, parses it into an abstract 
- * syntax tree (AST), generates intermediate representation (IR) code, and optionally 
- * executes the IR code using JIT compilation.
+ * syntax tree (AST), binds every name to its declaration, simplifies the AST, drops
+ * functions that are never called, generates intermediate representation (IR) code, optimizes it, and optionally 
+ * executes the IR code using JIT compilation. Several source files are compiled
+ * separately and linked ThinLTO-style (see compileSeparately).
  * 
  * Usage: 
- * ./toy_compiler <source-file>
+ * ./toy_compiler [options] <source-file>...
  * 
  * @param argc The number of command-line arguments.
  * @param argv The array of command-line arguments.
  * @return 0 if the program completes successfully, or 1 if there was an error.
  */
 int main(int argc, char* argv[]) {
-    // Check if the source file argument is provided
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <source-file>\n";
+    // Parse the command line; this also checks that a source file was provided
+    CompilerOptions options;
+    if (!parseOptions(argc, argv, options) || !checkTarget(options)) {
         return 1;
     }
 
-    // Open the source file for reading
-    std::ifstream inputFile(argv[1]);
-    if (!inputFile) {
-        std::cerr << "Could not open file " << argv[1] << std::endl;
-        return 1;
+    // Optimize the IR before it is printed or run, reporting on the passes if asked to
+    std::unique_ptr<PassReport> report;
+    if (options.timePasses || options.stats) {
+        report = std::make_unique<PassReport>(options.timePasses, options.stats);
+    }
+    if (options.inputFiles.size() > 1) {
+        return compileSeparately(options, report.get());
     }
 
-    // Read the entire source file into a string
-    std::string source((std::istreambuf_iterator<char>(inputFile)), std::istreambuf_iterator<char>());
-
-    // Create a lexer and parser for tokenizing and parsing the source code
-    Lexer lexer(source);
-    Parser parser(lexer);
+    std::unique_ptr<Program> ast = parseFile(options.inputFiles.front());
+    if (!ast || !resolveAndSimplify(*ast, options.inputFiles.front(), options, nullptr)) {
+        return 1;
+    }
 
-    // Parse the source code into an abstract syntax tree (AST)
-    auto ast = parser.parseExpression();
+    // Drop functions main can never call and hand the rest to code generation
+    // callees first, so their attributes are known when their callers are compiled
+    stripDeadFunctions(*ast);
+    sortFunctionsBottomUp(*ast);
 
     // Generate the intermediate representation (IR) code from the AST
+    // for the CPU selected with -mcpu/-mattr, or the host CPU
     CodeGen codeGen;
+    TargetSelection target = selectTarget(options);
+    std::unique_ptr<llvm::TargetMachine> machine = createTargetMachine(codeGen.getModule(), options);
+    if (!machine) return 1;
+    codeGen.setTarget(target.cpu, target.features, machine->createDataLayout());
+    // Source lines let optimization remarks point back at the toy loop they are about
+    if (!options.remarksFile.empty()) codeGen.emitLineTables(options.inputFiles.front());
     codeGen.generate(ast.get());
+    if (!codeGen.isValid()) {
+        return 1;
+    }
 
-    // Print the generated IR code
-    codeGen.printIR();
+    // Bring in the runtime functions the program calls, so they are optimized with it
+    if (!linkRuntime(codeGen.getModule())) {
+        return 1;
+    }
 
-    // Uncomment the next line to run JIT execution of the generated IR
-    // codeGen.runJIT();
+    // When code generation is split into parallel partitions, only the interprocedural
+    // part of the pipeline runs here and the partitions optimize themselves
+    PipelineStage stage = splitsCodeGeneration(options) ? PipelineStage::PreSplit : PipelineStage::Whole;
+    if (!Optimizer(options, report.get(), stage).run(codeGen.getModule())) {
+        return 1;
+    }
 
+    // Either run the program with JIT execution of the generated IR, or write the IR,
+    // assembly, object code or a linked executable
+    if (options.jit) {
+        CodeSizeReport sizes;
+        CodeSizeListener listener(sizes);
+        double timeToFirstCall = 0;
+        int result = codeGen.runJIT(codeGenOptLevel(options), targetOptions(options),
+                                    options.size ? &listener : nullptr, &timeToFirstCall);
+        if (options.size) sizes.print(llvm::errs());
+        if (report) {
+            report->recordJIT(timeToFirstCall,
+                              codeGenOptLevel(options) == llvm::CodeGenOpt::None ? "FastISel" : "SelectionDAG");
+            if (!writeReport(*report, options)) return 1;
+        }
+        return result;
+    }
+    if (!emitModule(codeGen.getModule(), options, report.get())) {
+        return 1;
+    }
+    // Written last: the partitions' pipelines add their passes to the report
+    if (report && !writeReport(*report, options)) {
+        return 1;
+    }
     return 0;
 }
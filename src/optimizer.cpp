@@ -0,0 +1,148 @@
+#include "optimizer.hpp"
+#include "backend.hpp"
+#include "pass_report.hpp"
+#include "profile.hpp"
+#include "remarks.hpp"
+#include <llvm/Analysis/CGSCCPassManager.h>
+#include <llvm/Analysis/LoopAnalysisManager.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Transforms/IPO/MergeFunctions.h>
+#include <llvm/Transforms/Instrumentation/PGOInstrumentation.h>
+#include <llvm/Transforms/Scalar/TailRecursionElimination.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Target/TargetMachine.h>
+#include <iostream>
+#include <memory>
+
+/**
+ * @brief Constructs an optimizer.
+ * 
+ * @param options The command line settings.
+ * @param report Receives per-pass timings and statistics; may be null.
+ * @param stage The part of the pipeline to run.
+ */
+Optimizer::Optimizer(const CompilerOptions &options, PassReport *report, PipelineStage stage)
+    : options(options), report(report), stage(stage) {}
+
+/**
+ * @brief Returns the PassBuilder optimization level matching an OptLevel.
+ */
+static llvm::OptimizationLevel passBuilderLevel(OptLevel level) {
+    switch (level) {
+        case OptLevel::O0: return llvm::OptimizationLevel::O0;
+        case OptLevel::O1: return llvm::OptimizationLevel::O1;
+        case OptLevel::O2: return llvm::OptimizationLevel::O2;
+        case OptLevel::O3: return llvm::OptimizationLevel::O3;
+        case OptLevel::Os: return llvm::OptimizationLevel::Os;
+        case OptLevel::Oz: return llvm::OptimizationLevel::Oz;
+    }
+    return llvm::OptimizationLevel::O0;
+}
+
+/**
+ * @brief Optimizes a module in place.
+ * 
+ * The tuning options follow clang: the loop and SLP vectorizers run at -O2, -O3
+ * and -Os, but not at -Oz. A custom pipeline is followed by the verifier, since
+ * arbitrary pass orders are not guaranteed to produce valid IR. With
+ * --profile-generate or --profile-use, the module is instrumented or annotated
+ * with the profile first; the annotated branch weights and entry counts then
+ * drive inlining, block placement and the other profile-aware passes.
+ * 
+ * At -Os and -Oz every function is marked `optsize`, and at -Oz also `minsize`,
+ * as clang does: the pipeline level alone only tunes the IR passes, while the
+ * code generator and some IR heuristics read the attributes. In --size mode,
+ * functions that compile to the same code are merged once the pipeline is done.
+ * 
+ * @param module The module to optimize.
+ * @return False if the target is unknown or the custom pipeline is invalid.
+ */
+bool Optimizer::run(llvm::Module &module) {
+    OptLevel level = options.optLevel;
+    const std::string &pipeline = options.passPipeline;
+    std::unique_ptr<llvm::TargetMachine> machine = createTargetMachine(module, options);
+    if (!machine) return false;
+    module.setDataLayout(machine->createDataLayout());
+    if (!options.remarksFile.empty() && !attachRemarks(module.getContext(), options)) return false;
+
+    if (level == OptLevel::Os || level == OptLevel::Oz) {
+        for (llvm::Function &function : module) {
+            if (function.isDeclaration()) continue;
+            function.addFnAttr(llvm::Attribute::OptimizeForSize);
+            if (level == OptLevel::Oz) function.addFnAttr(llvm::Attribute::MinSize);
+        }
+    }
+
+    llvm::PipelineTuningOptions tuning;
+    bool vectorize = level == OptLevel::O2 || level == OptLevel::O3 || level == OptLevel::Os;
+    tuning.LoopVectorization = vectorize;
+    tuning.SLPVectorization = vectorize;
+
+    llvm::LoopAnalysisManager loopAM;
+    llvm::FunctionAnalysisManager functionAM;
+    llvm::CGSCCAnalysisManager cgsccAM;
+    llvm::ModuleAnalysisManager moduleAM;
+
+    llvm::PassInstrumentationCallbacks callbacks;
+    if (report) report->registerCallbacks(callbacks);
+
+    llvm::PassBuilder builder(machine.get(), tuning, llvm::None, &callbacks);
+    builder.registerModuleAnalyses(moduleAM);
+    builder.registerCGSCCAnalyses(cgsccAM);
+    builder.registerFunctionAnalyses(functionAM);
+    builder.registerLoopAnalyses(loopAM);
+    builder.crossRegisterProxies(loopAM, functionAM, cgsccAM, moduleAM);
+
+    // Profile instrumentation and annotation see the IR exactly as CodeGen produced
+    // it, before any optimization, so the CFG hashes recorded by an instrumented
+    // build match those computed when the profile is used, whatever the -O levels.
+    if (stage != PipelineStage::PostSplit && (!options.profileGenerate.empty() || !options.profileUse.empty())) {
+        llvm::ModulePassManager profiling;
+        if (!options.profileGenerate.empty()) {
+            profiling.addPass(llvm::PGOInstrumentationGen());
+            profiling.addPass(ProfileCounterLowering(options.profileGenerate));
+        } else {
+            if (!llvm::sys::fs::exists(options.profileUse)) {
+                std::cerr << "Profile " << options.profileUse << " does not exist\n";
+                return false;
+            }
+            profiling.addPass(llvm::PGOInstrumentationUse(options.profileUse));
+        }
+        profiling.run(module, moduleAM);
+    }
+
+    llvm::ModulePassManager passes;
+    if (stage == PipelineStage::PostSplit && (!pipeline.empty() || level == OptLevel::O0)) {
+        // Everything already ran before the split.
+    } else if (!pipeline.empty()) {
+        if (auto err = builder.parsePassPipeline(passes, pipeline)) {
+            std::cerr << "Invalid pass pipeline: " << llvm::toString(std::move(err)) << "\n";
+            return false;
+        }
+        passes.addPass(llvm::VerifierPass());
+    } else if (level == OptLevel::O0) {
+        passes = builder.buildO0DefaultPipeline(llvm::OptimizationLevel::O0);
+        // Recursion written as a loop should run like one at every level: turn
+        // self-recursive tail calls, including accumulator recursion, into branches.
+        passes.addPass(llvm::createModuleToFunctionPassAdaptor(llvm::TailCallElimPass()));
+    } else if (stage == PipelineStage::PreSplit) {
+        passes = builder.buildThinLTOPreLinkDefaultPipeline(passBuilderLevel(level));
+    } else if (stage == PipelineStage::PostSplit) {
+        passes = builder.buildThinLTODefaultPipeline(passBuilderLevel(level), nullptr);
+    } else {
+        passes = builder.buildPerModuleDefaultPipeline(passBuilderLevel(level));
+    }
+    // Merging runs on the whole module, before any split, so that identical
+    // functions are found across future partitions.
+    if (options.size && pipeline.empty() && stage != PipelineStage::PostSplit) {
+        passes.addPass(llvm::MergeFunctionsPass());
+    }
+
+    passes.run(module, moduleAM);
+    return true;
+}
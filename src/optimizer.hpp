@@ -0,0 +1,63 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "options.hpp"
+
+namespace llvm {
+class Module;
+}
+class PassReport;
+
+/**
+ * @brief The part of the pipeline an Optimizer runs.
+ * 
+ * When code generation is split into partitions (see emitModule), the pipeline is
+ * split the way ThinLTO splits it: the pre-link part, including the inliner and
+ * the other interprocedural passes, runs once on the whole module, and the
+ * post-link part, where most function-level optimization happens, runs on each
+ * partition.
+ */
+enum class PipelineStage { Whole, PreSplit, PostSplit };
+
+/**
+ * @brief Runs an LLVM optimization pipeline over a generated module.
+ * 
+ * The pipeline is built with the new pass manager's PassBuilder, either as the
+ * default pipeline for an optimization level or parsed from a textual description
+ * in `opt -passes=` syntax. A target machine for the module's triple is handed to
+ * the PassBuilder so that cost-model driven passes (inlining, unrolling,
+ * vectorization) see the real target instead of a generic one.
+ */
+class Optimizer {
+public:
+    /**
+     * @brief Constructs an optimizer.
+     * 
+     * @param options The command line settings: the optimization level of the default
+     *        pipeline, a custom pipeline used instead of it if non-empty, and the target.
+     * @param report Receives per-pass timings and statistics; may be null.
+     * @param stage The part of the pipeline to run. A custom pipeline runs in full
+     *        in the Whole and PreSplit stages, and PostSplit then does nothing.
+     */
+    explicit Optimizer(const CompilerOptions &options, PassReport *report = nullptr,
+                       PipelineStage stage = PipelineStage::Whole);
+
+    /**
+     * @brief Optimizes a module in place.
+     * 
+     * Also sets the module's data layout to the one of its target, and with
+     * --remarks streams the module's optimization remarks into the remarks file.
+     * 
+     * @param module The module to optimize.
+     * @return False if the target is unknown, the custom pipeline is invalid or the
+     *         remarks file cannot be written.
+     */
+    bool run(llvm::Module &module);
+
+private:
+    const CompilerOptions &options; ///< Level, custom pipeline and target.
+    PassReport *report;             ///< Instrumentation for the pipeline, or null.
+    PipelineStage stage;            ///< The part of the pipeline to run.
+};
+
+#endif
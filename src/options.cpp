@@ -0,0 +1,160 @@
+#include "options.hpp"
+#include <iostream>
+
+/**
+ * @brief Prints the usage text to std::cerr.
+ * 
+ * @param program The name the compiler was invoked as.
+ */
+static void printUsage(const char *program) {
+    std::cerr << "Usage: " << program << " [options] <source-file>...\n"
+              << "Options:\n"
+              << "  --eval-budget=<n>   Steps allowed when evaluating a call at compile time (0 disables)\n"
+              << "  --jit               Run the program instead of printing its IR\n"
+              << "  -O0 -O1 -O2 -O3     Optimization level (default -O0)\n"
+              << "  -Os -Oz             Optimize for size\n"
+              << "  --size              Minimize code size: -Oz plus function merging and machine outlining;\n"
+              << "                      prints the machine code size of each function (obj, exe, --jit)\n"
+              << "  --fast-codegen      Generate machine code quickly (FastISel, fast register allocation,\n"
+              << "                      no machine-level optimization) after any -O level of IR optimization\n"
+              << "  --passes=<pipeline> Run a custom pass pipeline, e.g. --passes='function(instcombine)'\n"
+              << "  --time-passes       Report the time spent in each pass, per function, as JSON;\n"
+              << "                      with --jit, also the time from starting the JIT to calling main\n"
+              << "  --stats             Report what each pass changed, per function, and LLVM statistics as JSON\n"
+              << "  --report-file=<f>   Write the JSON report to <f> instead of stderr\n"
+              << "  --remarks=<f.yaml>  Write optimization remarks (passed, missed, analysis) of the inliner,\n"
+              << "                      vectorizers, LICM and loop unrolling, with toy source lines, to <f.yaml>\n"
+              << "  --remarks-filter=<regex>  Keep only the remarks of functions whose name matches <regex>\n"
+              << "  --emit=<kind>       Output ir (default), bc, asm, obj or exe\n"
+              << "  -o <file>           Output file ('-' for stdout; a FIFO also works)\n"
+              << "  --pipe-to=<command> Stream the output into a shell command, e.g. --pipe-to='llc -o out.s'\n"
+              << "  -mcpu=<cpu>         Target CPU (default: the host CPU; -march=<cpu> is an alias)\n"
+              << "  -mattr=<features>   Enable or disable target features, e.g. -mattr=+avx2,-avx512f\n"
+              << "  --profile-generate[=<file>]  Instrument the program to write an execution profile\n"
+              << "                      (default: default.proftext) when main returns\n"
+              << "  --profile-use=<file>  Optimize with a profile merged by llvm-profdata (.profdata)\n"
+              << "  -j<n>, --jobs=<n>   Generate objects and executables in <n> parallel partitions (0: all cores)\n"
+              << "Several source files are compiled ThinLTO-style: each gets a module summary, a thin link\n"
+              << "imports small callees across files, and the files are then optimized in parallel (-j).\n"
+              << "ir, bc, asm and obj are written next to each source; -o names a linked exe or a combined obj.\n";
+}
+
+/**
+ * @brief Parses the command line into a CompilerOptions.
+ * 
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @param options Receives the parsed settings.
+ * @return False if the command line is invalid.
+ */
+bool parseOptions(int argc, char *argv[], CompilerOptions &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&](const char *prefix) { return arg.substr(std::string(prefix).size()); };
+
+        try {
+            if (arg.rfind("--eval-budget=", 0) == 0) {
+                options.evalBudget = std::stoul(value("--eval-budget="));
+            } else if (arg == "--jit") {
+                options.jit = true;
+            } else if (arg == "-O0" || arg == "-O1" || arg == "-O2" || arg == "-O3") {
+                options.optLevel = static_cast<OptLevel>(arg[2] - '0');
+            } else if (arg == "-Os") {
+                options.optLevel = OptLevel::Os;
+            } else if (arg == "-Oz") {
+                options.optLevel = OptLevel::Oz;
+            } else if (arg == "--size") {
+                options.size = true;
+            } else if (arg.rfind("--remarks=", 0) == 0) {
+                options.remarksFile = value("--remarks=");
+            } else if (arg.rfind("--remarks-filter=", 0) == 0) {
+                options.remarksFilter = value("--remarks-filter=");
+            } else if (arg == "--fast-codegen") {
+                options.fastCodegen = true;
+            } else if (arg.rfind("--passes=", 0) == 0) {
+                options.passPipeline = value("--passes=");
+            } else if (arg == "--time-passes") {
+                options.timePasses = true;
+            } else if (arg == "--stats") {
+                options.stats = true;
+            } else if (arg.rfind("--report-file=", 0) == 0) {
+                options.reportFile = value("--report-file=");
+            } else if (arg.rfind("--emit=", 0) == 0) {
+                std::string kind = value("--emit=");
+                if (kind == "ir") {
+                    options.emit = EmitKind::IR;
+                } else if (kind == "bc") {
+                    options.emit = EmitKind::Bitcode;
+                } else if (kind == "asm") {
+                    options.emit = EmitKind::Asm;
+                } else if (kind == "obj") {
+                    options.emit = EmitKind::Object;
+                } else if (kind == "exe") {
+                    options.emit = EmitKind::Executable;
+                } else {
+                    std::cerr << "Unknown output kind " << kind << "\n";
+                    return false;
+                }
+            } else if (arg.rfind("--pipe-to=", 0) == 0) {
+                options.pipeCommand = value("--pipe-to=");
+            } else if (arg.rfind("-mcpu=", 0) == 0) {
+                options.cpu = value("-mcpu=");
+            } else if (arg.rfind("-march=", 0) == 0) {
+                options.cpu = value("-march=");
+            } else if (arg.rfind("-mattr=", 0) == 0) {
+                options.attrs = value("-mattr=");
+            } else if (arg == "--profile-generate") {
+                options.profileGenerate = "default.proftext";
+            } else if (arg.rfind("--profile-generate=", 0) == 0) {
+                options.profileGenerate = value("--profile-generate=");
+            } else if (arg.rfind("--profile-use=", 0) == 0) {
+                options.profileUse = value("--profile-use=");
+            } else if (arg.rfind("--jobs=", 0) == 0) {
+                options.jobs = std::stoul(value("--jobs="));
+            } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2) {
+                options.jobs = std::stoul(value("-j"));
+            } else if (arg == "-o") {
+                if (++i == argc) {
+                    std::cerr << "-o needs a file name\n";
+                    return false;
+                }
+                options.outputFile = argv[i];
+            } else if (arg.size() > 1 && arg[0] == '-') {
+                std::cerr << "Unknown option " << arg << "\n";
+                printUsage(argv[0]);
+                return false;
+            } else {
+                options.inputFiles.push_back(arg);
+            }
+        } catch (const std::exception &) {
+            std::cerr << "Invalid value in " << arg << "\n";
+            return false;
+        }
+    }
+
+    if (options.inputFiles.empty()) {
+        printUsage(argv[0]);
+        return false;
+    }
+    if (options.size) options.optLevel = OptLevel::Oz;
+    if (!options.profileGenerate.empty() && !options.profileUse.empty()) {
+        std::cerr << "--profile-generate and --profile-use cannot be combined\n";
+        return false;
+    }
+    if (!options.remarksFilter.empty() && options.remarksFile.empty()) {
+        std::cerr << "--remarks-filter needs --remarks=<file>\n";
+        return false;
+    }
+    if (options.inputFiles.size() > 1) {
+        if (options.jit || !options.profileGenerate.empty()) {
+            std::cerr << "--jit and --profile-generate take a single source file\n";
+            return false;
+        }
+        bool linked = options.emit == EmitKind::Executable || options.emit == EmitKind::Object;
+        if (!linked && (!options.outputFile.empty() || !options.pipeCommand.empty())) {
+            std::cerr << "-o and --pipe-to need --emit=obj or --emit=exe when several source files are given\n";
+            return false;
+        }
+    }
+    return true;
+}
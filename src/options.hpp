@@ -0,0 +1,56 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Optimization levels selectable with -O0 to -O3, -Os and -Oz.
+ */
+enum class OptLevel { O0, O1, O2, O3, Os, Oz };
+
+/**
+ * @brief Output forms selectable with --emit=.
+ */
+enum class EmitKind { IR, Bitcode, Asm, Object, Executable };
+
+/**
+ * @brief Settings taken from the command line.
+ */
+struct CompilerOptions {
+    std::vector<std::string> inputFiles; ///< The source files to compile; the first names default outputs.
+    unsigned long evalBudget = 100000; ///< Step budget for compile-time evaluation of calls (0 disables it).
+    bool jit = false;                  ///< Run the program's main in-process instead of printing IR.
+    OptLevel optLevel = OptLevel::O0;  ///< Optimization level of the default pipeline.
+    std::string passPipeline;          ///< Custom pass pipeline replacing the default one, if non-empty.
+    bool timePasses = false;           ///< Report the time spent in each optimization pass.
+    bool stats = false;                ///< Report what each optimization pass changed and LLVM's statistics.
+    std::string reportFile;            ///< Where the JSON pass report goes; stderr if empty.
+    EmitKind emit = EmitKind::IR;      ///< What to write when not running the program.
+    std::string outputFile;            ///< Output path; empty for the default, "-" for stdout.
+    std::string pipeCommand;           ///< Shell command to pipe the output into, if non-empty.
+    std::string cpu;                   ///< Target CPU name; empty or "native" for the host CPU.
+    std::string attrs;                 ///< Target features to add or remove, e.g. "+avx2,-avx512f".
+    std::string profileGenerate;       ///< Profile file written by the instrumented program; empty for no instrumentation.
+    std::string profileUse;            ///< Indexed profile (.profdata) to optimize with; empty for none.
+    unsigned jobs = 1;                 ///< Threads (and module partitions) for code generation; 0 for all cores.
+    bool size = false;                 ///< Minimize code size: -Oz, MergeFunctions, the machine outliner and a size report.
+    std::string remarksFile;           ///< YAML file receiving optimization remarks; empty for none.
+    std::string remarksFilter;         ///< Regular expression selecting the functions whose remarks are kept.
+    bool fastCodegen = false;          ///< Generate code quickly: FastISel, the fast register allocator, no machine optimizations.
+};
+
+/**
+ * @brief Parses the command line into a CompilerOptions.
+ * 
+ * Unknown options and a missing source file are reported to std::cerr together
+ * with the usage text.
+ * 
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @param options Receives the parsed settings.
+ * @return False if the command line is invalid.
+ */
+bool parseOptions(int argc, char *argv[], CompilerOptions &options);
+
+#endif
@@ -11,6 +11,8 @@
  * constructs an abstract syntax tree (AST). This AST represents the syntactical 
  * structure of the source code based on the grammar rules. The parser is responsible 
  * for handling expressions and constructing nodes for the tree.
+ * 
+ * Syntax errors are reported by throwing std::runtime_error.
  */
 class Parser {
 public:
@@ -25,6 +27,27 @@ public:
      */
     explicit Parser(Lexer &lexer);
 
+    /**
+     * @brief Parses a whole source file and returns the corresponding Program node.
+     * 
+     * Function definitions become FunctionDecl nodes. Any statements found outside of
+     * a function are gathered into an implicit `main`.
+     * 
+     * @return A unique pointer to the Program node.
+     */
+    std::unique_ptr<Program> parseProgram();
+
+    /**
+     * @brief Parses a single statement and returns the corresponding AST node.
+     * 
+     * Statements are declarations, assignments, blocks, "if", "while", "switch",
+     * "break", "return" and expression statements. The node records the line of
+     * the statement's first token, or of the `while` keyword after `#pragma`s.
+     * 
+     * @return A unique pointer to the AST node representing the parsed statement.
+     */
+    std::unique_ptr<ASTNode> parseStatement();
+
     /**
      * @brief Parses an expression and returns the corresponding AST node.
      * 
@@ -58,9 +81,67 @@ public:
      */
     std::unique_ptr<ASTNode> parseWhileStatement();
 
+    /**
+     * @brief Parses a "switch" statement and returns the corresponding AST node.
+     * 
+     * The body is a sequence of sections, each introduced by one or more `case N:`
+     * or `default:` labels. Case values are integer constants, optionally negated.
+     * 
+     * @return A unique pointer to the SwitchStatement node.
+     * @throws std::runtime_error On a duplicate case value or a second `default`.
+     */
+    std::unique_ptr<ASTNode> parseSwitchStatement();
+
 private:
     Lexer &lexer;         /**< Reference to the lexer used for tokenizing the input */
     Token currentToken;   /**< The current token being processed */
+
+    /**
+     * @brief Moves on to the next token.
+     */
+    void advance();
+
+    /**
+     * @brief Consumes the current token if it has the expected type.
+     * 
+     * @param type The expected token type.
+     * @param what Description of the expected token, used in the error message.
+     * @return The value of the consumed token.
+     * @throws std::runtime_error If the current token has a different type.
+     */
+    std::string expect(TokenType type, const char *what);
+
+    /**
+     * @brief Parses a parenthesized condition, optionally wrapped in likely() or unlikely().
+     * 
+     * @param statement Description of the opening parenthesis, used in error messages.
+     * @param hint Receives the annotation, or BranchHint::None.
+     * @return The condition expression.
+     */
+    std::unique_ptr<ASTNode> parseCondition(const char *statement, BranchHint &hint);
+
+    /**
+     * @brief Parses one `#pragma name(N)` loop hint into a set of hints.
+     * 
+     * @param hints Receives the hint.
+     * @throws std::runtime_error If the pragma is unknown or its argument is not a positive number.
+     */
+    void parsePragma(LoopHints &hints);
+
+    /**
+     * @brief Parses the constant of a `case` label.
+     * 
+     * @return The value.
+     * @throws std::runtime_error If it is not an integer constant in the range of int.
+     */
+    int parseCaseValue();
+
+    std::unique_ptr<ASTNode> parseStatementKind();
+    std::unique_ptr<FunctionDecl> parseFunction(const std::string &name);
+    std::unique_ptr<Block> parseBlock();
+    std::unique_ptr<ASTNode> parseDeclaration(const std::string &name);
+    std::unique_ptr<ASTNode> parsePrimary();
+    std::unique_ptr<ASTNode> parseBinaryRHS(int minPrecedence, std::unique_ptr<ASTNode> left);
 };
 
 #endif
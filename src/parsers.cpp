@@ -1,4 +1,25 @@
 #include "parser.hpp"
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_set>
+
+/**
+ * @brief Converts the digits of an integer literal, checking that the value fits in an int.
+ * 
+ * @param digits The literal's digits.
+ * @param negative Whether the literal is negated, which admits 2147483648.
+ * @param what Description of the literal, used in the error message.
+ * @return The value, negated if negative is set.
+ * @throws std::runtime_error If the value is out of range.
+ */
+static int literalValue(const std::string &digits, bool negative, const std::string &what) {
+    long long value = digits.size() > 10 ? INT64_MAX : std::stoll(digits);
+    if (negative) value = -value;
+    if (value < INT32_MIN || value > INT32_MAX) {
+        throw std::runtime_error(what + " " + (negative ? "-" : "") + digits + " is out of range");
+    }
+    return static_cast<int>(value);
+}
 
 /**
  * @brief Constructs a Parser with the provided Lexer.
@@ -10,39 +31,340 @@
  */
 Parser::Parser(Lexer &lex) : lexer(lex) { currentToken = lexer.getNextToken(); }
 
+/**
+ * @brief Moves on to the next token.
+ */
+void Parser::advance() { currentToken = lexer.getNextToken(); }
+
+/**
+ * @brief Consumes the current token if it has the expected type.
+ * 
+ * @param type The expected token type.
+ * @param what Description of the expected token, used in the error message.
+ * @return The value of the consumed token.
+ * @throws std::runtime_error If the current token has a different type.
+ */
+std::string Parser::expect(TokenType type, const char *what) {
+    if (currentToken.type != type) {
+        std::string found = currentToken.type == TokenType::END ? "end of input" : "'" + currentToken.value + "'";
+        throw std::runtime_error(std::string("expected ") + what + ", found " + found);
+    }
+    std::string value = currentToken.value;
+    advance();
+    return value;
+}
+
+/**
+ * @brief Parses a whole source file and returns the corresponding Program node.
+ * 
+ * A definition is recognised by the '(' that follows `int name`. Everything else at
+ * the top level is a statement and is appended to the body of an implicit `main`,
+ * which is only allowed when the file does not define `main` itself.
+ * 
+ * @return A unique pointer to the Program node.
+ */
+std::unique_ptr<Program> Parser::parseProgram() {
+    auto program = std::make_unique<Program>();
+    auto topLevel = std::make_unique<Block>();
+
+    while (currentToken.type != TokenType::END) {
+        if (currentToken.type == TokenType::INT) {
+            unsigned line = currentToken.line;
+            advance();
+            std::string name = expect(TokenType::IDENTIFIER, "a name after 'int'");
+            if (currentToken.type == TokenType::PAREN_OPEN) {
+                program->functions.push_back(parseFunction(name));
+                program->functions.back()->line = line;
+            } else {
+                topLevel->statements.push_back(parseDeclaration(name));
+                topLevel->statements.back()->line = line;
+            }
+            continue;
+        }
+        topLevel->statements.push_back(parseStatement());
+    }
+
+    if (!topLevel->statements.empty()) {
+        for (const auto &function : program->functions) {
+            if (function->name == "main") {
+                throw std::runtime_error("top-level statements are not allowed when 'main' is defined");
+            }
+        }
+        unsigned line = topLevel->statements.front()->line;
+        program->functions.push_back(
+            std::make_unique<FunctionDecl>("main", std::vector<std::string>(), std::move(topLevel)));
+        program->functions.back()->line = line;
+    }
+    return program;
+}
+
+/**
+ * @brief Parses a function definition after its `int name` prefix.
+ * 
+ * @param name The name of the function, already consumed.
+ * @return A unique pointer to the FunctionDecl node.
+ */
+std::unique_ptr<FunctionDecl> Parser::parseFunction(const std::string &name) {
+    expect(TokenType::PAREN_OPEN, "'('");
+    std::vector<std::string> params;
+    if (currentToken.type != TokenType::PAREN_CLOSE) {
+        do {
+            if (!params.empty()) advance(); // Skip ','
+            expect(TokenType::INT, "'int' before parameter name");
+            params.push_back(expect(TokenType::IDENTIFIER, "a parameter name"));
+        } while (currentToken.type == TokenType::COMMA);
+    }
+    expect(TokenType::PAREN_CLOSE, "')'");
+
+    auto body = parseBlock();
+    return std::make_unique<FunctionDecl>(name, std::move(params), std::move(body));
+}
+
+/**
+ * @brief Parses a braced block of statements.
+ * 
+ * @return A unique pointer to the Block node.
+ */
+std::unique_ptr<Block> Parser::parseBlock() {
+    expect(TokenType::BRACE_OPEN, "'{'");
+    auto block = std::make_unique<Block>();
+    while (currentToken.type != TokenType::BRACE_CLOSE && currentToken.type != TokenType::END) {
+        block->statements.push_back(parseStatement());
+    }
+    expect(TokenType::BRACE_CLOSE, "'}'");
+    return block;
+}
+
+/**
+ * @brief Parses the rest of a variable declaration after its `int name` prefix.
+ * 
+ * @param name The name of the variable, already consumed.
+ * @return A unique pointer to the VarDecl node.
+ */
+std::unique_ptr<ASTNode> Parser::parseDeclaration(const std::string &name) {
+    std::unique_ptr<ASTNode> init;
+    if (currentToken.type == TokenType::ASSIGN) {
+        advance();
+        init = parseExpression();
+    }
+    expect(TokenType::SEMICOLON, "';' after declaration");
+    return std::make_unique<VarDecl>(name, std::move(init));
+}
+
+/**
+ * @brief Parses a single statement and returns the corresponding AST node.
+ * 
+ * @return A unique pointer to the AST node representing the parsed statement,
+ *         which records the line the statement starts on.
+ */
+std::unique_ptr<ASTNode> Parser::parseStatement() {
+    unsigned line = currentToken.line;
+    std::unique_ptr<ASTNode> statement = parseStatementKind();
+    if (statement->line == 0) statement->line = line;
+    return statement;
+}
+
+/**
+ * @brief Parses a statement, dispatching on its leading token.
+ * 
+ * An identifier followed by '=' is an assignment; any other statement that does
+ * not start with a keyword or '{' is an expression statement terminated by ';'.
+ * 
+ * @return The statement, without a line unless its own parser records one.
+ */
+std::unique_ptr<ASTNode> Parser::parseStatementKind() {
+    switch (currentToken.type) {
+        case TokenType::INT: {
+            advance();
+            std::string name = expect(TokenType::IDENTIFIER, "a variable name after 'int'");
+            return parseDeclaration(name);
+        }
+        case TokenType::IF:
+            return parseIfStatement();
+        case TokenType::WHILE:
+            return parseWhileStatement();
+        case TokenType::SWITCH:
+            return parseSwitchStatement();
+        case TokenType::BREAK:
+            advance();
+            expect(TokenType::SEMICOLON, "';' after break");
+            return std::make_unique<BreakStatement>();
+        case TokenType::PRAGMA: {
+            LoopHints hints;
+            while (currentToken.type == TokenType::PRAGMA) parsePragma(hints);
+            if (currentToken.type != TokenType::WHILE) {
+                throw std::runtime_error("expected a 'while' loop after '#pragma'");
+            }
+            auto loop = parseWhileStatement();
+            static_cast<WhileStatement &>(*loop).hints = hints;
+            return loop;
+        }
+        case TokenType::BRACE_OPEN:
+            return parseBlock();
+        case TokenType::RETURN: {
+            advance();
+            std::unique_ptr<ASTNode> value;
+            if (currentToken.type != TokenType::SEMICOLON) value = parseExpression();
+            expect(TokenType::SEMICOLON, "';' after return");
+            return std::make_unique<ReturnStatement>(std::move(value));
+        }
+        case TokenType::IDENTIFIER:
+            if (lexer.peekToken().type == TokenType::ASSIGN) {
+                std::string name = currentToken.value;
+                advance(); // Skip the name
+                advance(); // Skip '='
+                auto value = parseExpression();
+                expect(TokenType::SEMICOLON, "';' after assignment");
+                return std::make_unique<Assignment>(name, std::move(value));
+            }
+            break;
+        default:
+            break;
+    }
+
+    auto expr = parseExpression();
+    expect(TokenType::SEMICOLON, "';' after expression");
+    return expr;
+}
+
+/**
+ * @brief Returns the binding strength of a binary operator token, or -1.
+ * 
+ * @param token The token to classify.
+ * @return The precedence; higher binds tighter.
+ */
+static int precedence(const Token &token) {
+    if (token.type != TokenType::OPERATOR) return -1;
+    const std::string &op = token.value;
+    if (op == "*" || op == "/") return 20;
+    if (op == "+" || op == "-") return 10;
+    if (op == "<" || op == "<=" || op == ">" || op == ">=") return 8;
+    if (op == "==" || op == "!=") return 6;
+    if (op == "&&") return 4;
+    if (op == "||") return 2;
+    return -1;
+}
+
+/**
+ * @brief Maps a binary operator token to its BinaryOp.
+ * 
+ * @param token An OPERATOR token.
+ * @return The corresponding operator.
+ */
+static BinaryOp binaryOp(const Token &token) {
+    const std::string &op = token.value;
+    if (op == "+") return BinaryOp::Add;
+    if (op == "-") return BinaryOp::Sub;
+    if (op == "*") return BinaryOp::Mul;
+    if (op == "/") return BinaryOp::Div;
+    if (op == "<") return BinaryOp::Lt;
+    if (op == "<=") return BinaryOp::Le;
+    if (op == ">") return BinaryOp::Gt;
+    if (op == ">=") return BinaryOp::Ge;
+    if (op == "==") return BinaryOp::Eq;
+    if (op == "!=") return BinaryOp::Ne;
+    if (op == "&&") return BinaryOp::And;
+    return BinaryOp::Or;
+}
+
 /**
  * @brief Parses an expression and returns the corresponding AST node.
  * 
- * This method parses a simple arithmetic expression. It handles the parsing 
- * of numbers, operators, and constructs a binary expression tree if there is an 
- * operator in the expression. The method supports recursive parsing for expressions 
- * with multiple operands and operators.
+ * This method parses an expression by precedence climbing. From tightest to
+ * loosest, the binary operators are `* /`, `+ -`, `< <= > >=`, `== !=`, `&&` and
+ * `||`, as in C; operators of equal precedence associate to the left.
  * 
  * @return A unique pointer to the root AST node representing the parsed expression.
- *         It can either be a single number or a binary expression.
+ *         It can either be a single operand or a binary expression.
  */
 std::unique_ptr<ASTNode> Parser::parseExpression() {
-    // Parse the left-hand side of the expression as a number.
-    auto left = std::make_unique<NumberExpr>(std::stoi(currentToken.value));
-
-    // Move to the next token after parsing the number.
-    currentToken = lexer.getNextToken();
+    return parseBinaryRHS(0, parsePrimary());
+}
 
-    // If the next token is an operator, parse the right-hand side of the expression.
-    if (currentToken.type == TokenType::OPERATOR) {
-        // Get the operator and move to the next token.
-        char op = currentToken.value[0];
-        currentToken = lexer.getNextToken();
+/**
+ * @brief Parses the operator/operand pairs following a left operand.
+ * 
+ * @param minPrecedence Operators binding weaker than this end the expression.
+ * @param left The already parsed left operand.
+ * @return The combined expression.
+ */
+std::unique_ptr<ASTNode> Parser::parseBinaryRHS(int minPrecedence, std::unique_ptr<ASTNode> left) {
+    while (precedence(currentToken) >= minPrecedence) {
+        int prec = precedence(currentToken);
+        BinaryOp op = binaryOp(currentToken);
+        advance();
 
-        // Recursively parse the right-hand side expression and create a BinaryExpr node.
-        auto right = parseExpression();
-        return std::make_unique<BinaryExpr>(std::move(left), op, std::move(right));
+        auto right = parsePrimary();
+        // If the next operator binds tighter, it takes the right operand first.
+        if (precedence(currentToken) > prec) {
+            right = parseBinaryRHS(prec + 1, std::move(right));
+        }
+        left = std::make_unique<BinaryExpr>(std::move(left), op, std::move(right));
     }
-
-    // If no operator is found, return the left-hand side (which is a number).
     return left;
 }
 
+/**
+ * @brief Parses a number, variable, call, parenthesised expression, negation or logical not.
+ * 
+ * @return A unique pointer to the AST node for the operand.
+ */
+std::unique_ptr<ASTNode> Parser::parsePrimary() {
+    switch (currentToken.type) {
+        case TokenType::NUMBER: {
+            auto number = std::make_unique<NumberExpr>(literalValue(currentToken.value, false, "integer literal"));
+            advance();
+            return number;
+        }
+        case TokenType::IDENTIFIER: {
+            std::string name = currentToken.value;
+            advance();
+            if (currentToken.type != TokenType::PAREN_OPEN) {
+                return std::make_unique<VariableExpr>(name);
+            }
+            advance(); // Skip '('
+            auto call = std::make_unique<FunctionCall>(name);
+            if (currentToken.type != TokenType::PAREN_CLOSE) {
+                call->args.push_back(parseExpression());
+                while (currentToken.type == TokenType::COMMA) {
+                    advance();
+                    call->args.push_back(parseExpression());
+                }
+            }
+            expect(TokenType::PAREN_CLOSE, "')' after arguments");
+            return call;
+        }
+        case TokenType::PAREN_OPEN: {
+            advance();
+            auto expr = parseExpression();
+            expect(TokenType::PAREN_CLOSE, "')'");
+            return expr;
+        }
+        case TokenType::OPERATOR:
+            if (currentToken.value == "-") {
+                // A negated literal is a constant, so the most negative int can be written;
+                // otherwise unary minus is sugar for 0 - operand.
+                advance();
+                if (currentToken.type == TokenType::NUMBER) {
+                    auto number = std::make_unique<NumberExpr>(literalValue(currentToken.value, true, "integer literal"));
+                    advance();
+                    return number;
+                }
+                return std::make_unique<BinaryExpr>(std::make_unique<NumberExpr>(0), BinaryOp::Sub, parsePrimary());
+            }
+            if (currentToken.value == "!") {
+                // Logical negation is sugar for operand == 0.
+                advance();
+                return std::make_unique<BinaryExpr>(parsePrimary(), BinaryOp::Eq, std::make_unique<NumberExpr>(0));
+            }
+            break;
+        default:
+            break;
+    }
+    expect(TokenType::NUMBER, "an expression");
+    return nullptr;
+}
+
 /**
  * @brief Parses an "if" statement and returns the corresponding AST node.
  * 
@@ -53,26 +375,77 @@ std::unique_ptr<ASTNode> Parser::parseExpression() {
  * @return A unique pointer to the AST node representing the parsed "if" statement.
  */
 std::unique_ptr<ASTNode> Parser::parseIfStatement() {
-    currentToken = lexer.getNextToken(); // Skip 'if'
+    advance(); // Skip 'if'
     
     // Parse the condition expression inside the if statement.
-    auto condition = parseExpression();
-    
-    currentToken = lexer.getNextToken(); // Skip '{'
+    BranchHint hint;
+    auto condition = parseCondition("'(' after 'if'", hint);
     
     // Parse the then branch of the if statement.
-    auto thenBranch = parseExpression();
+    auto thenBranch = parseStatement();
     
     std::unique_ptr<ASTNode> elseBranch = nullptr;
 
     // If there is an 'else' part, parse it.
     if (currentToken.type == TokenType::ELSE) {
-        currentToken = lexer.getNextToken();
-        elseBranch = parseExpression();
+        advance();
+        elseBranch = parseStatement();
     }
 
     // Return the constructed IfStatement node.
-    return std::make_unique<IfStatement>(std::move(condition), std::move(thenBranch), std::move(elseBranch));
+    auto ifStmt = std::make_unique<IfStatement>(std::move(condition), std::move(thenBranch), std::move(elseBranch));
+    ifStmt->hint = hint;
+    return ifStmt;
+}
+
+/**
+ * @brief Parses a parenthesized condition, optionally wrapped in likely() or unlikely().
+ * 
+ * The hint must enclose the whole condition, as in `if (unlikely(x / y))`. Inside
+ * a condition the two names always denote hints, never function calls.
+ * 
+ * @param statement Description of the opening parenthesis, used in error messages.
+ * @param hint Receives the annotation, or BranchHint::None.
+ * @return The condition expression.
+ */
+std::unique_ptr<ASTNode> Parser::parseCondition(const char *statement, BranchHint &hint) {
+    expect(TokenType::PAREN_OPEN, statement);
+    hint = BranchHint::None;
+    if (currentToken.type == TokenType::IDENTIFIER &&
+        (currentToken.value == "likely" || currentToken.value == "unlikely")) {
+        hint = currentToken.value == "likely" ? BranchHint::Likely : BranchHint::Unlikely;
+        advance();
+        expect(TokenType::PAREN_OPEN, "'(' after the branch hint");
+    }
+    auto condition = parseExpression();
+    if (hint != BranchHint::None) expect(TokenType::PAREN_CLOSE, "')' closing the branch hint");
+    expect(TokenType::PAREN_CLOSE, "')' after condition");
+    return condition;
+}
+
+/**
+ * @brief Parses one `#pragma name(N)` loop hint into a set of hints.
+ * 
+ * The supported hints are unroll, vectorize and interleave. A later pragma of the
+ * same kind replaces an earlier one.
+ * 
+ * @param hints Receives the hint.
+ */
+void Parser::parsePragma(LoopHints &hints) {
+    advance(); // Skip '#pragma'
+    std::string name = expect(TokenType::IDENTIFIER, "a hint name after '#pragma'");
+    unsigned *target = name == "unroll"       ? &hints.unrollCount
+                       : name == "vectorize"  ? &hints.vectorizeWidth
+                       : name == "interleave" ? &hints.interleaveCount
+                                              : nullptr;
+    if (!target) throw std::runtime_error("unknown pragma '" + name + "'");
+
+    expect(TokenType::PAREN_OPEN, "'(' after the pragma name");
+    std::string value = expect(TokenType::NUMBER, "a count in the pragma");
+    expect(TokenType::PAREN_CLOSE, "')' after the pragma count");
+    unsigned long count = value.size() > 9 ? 0 : std::stoul(value);
+    if (count == 0) throw std::runtime_error("'#pragma " + name + "' needs a positive count");
+    *target = static_cast<unsigned>(count);
 }
 
 /**
@@ -85,16 +458,84 @@ std::unique_ptr<ASTNode> Parser::parseIfStatement() {
  * @return A unique pointer to the AST node representing the parsed "while" statement.
  */
 std::unique_ptr<ASTNode> Parser::parseWhileStatement() {
-    currentToken = lexer.getNextToken(); // Skip 'while'
+    unsigned line = currentToken.line;
+    advance(); // Skip 'while'
     
     // Parse the condition expression inside the while loop.
-    auto condition = parseExpression();
-    
-    currentToken = lexer.getNextToken(); // Skip '{'
+    BranchHint hint;
+    auto condition = parseCondition("'(' after 'while'", hint);
     
     // Parse the body of the while loop.
-    auto body = parseExpression();
+    auto body = parseStatement();
     
     // Return the constructed WhileStatement node.
-    return std::make_unique<WhileStatement>(std::move(condition), std::move(body));
+    auto whileStmt = std::make_unique<WhileStatement>(std::move(condition), std::move(body));
+    whileStmt->hint = hint;
+    whileStmt->line = line;
+    return whileStmt;
+}
+
+/**
+ * @brief Parses a "switch" statement and returns the corresponding AST node.
+ * 
+ * Consecutive labels share one section. Statements are collected into the most
+ * recent section until the next label; a statement before the first label is an
+ * error, since it could never run.
+ * 
+ * @return A unique pointer to the SwitchStatement node.
+ */
+std::unique_ptr<ASTNode> Parser::parseSwitchStatement() {
+    advance(); // Skip 'switch'
+    expect(TokenType::PAREN_OPEN, "'(' after 'switch'");
+    auto switchStmt = std::make_unique<SwitchStatement>(parseExpression());
+    expect(TokenType::PAREN_CLOSE, "')' after switch value");
+    expect(TokenType::BRACE_OPEN, "'{' after switch value");
+
+    std::unordered_set<int> seen;
+    bool hasDefault = false;
+    bool labelled = false; // The last section has labels but no statements yet.
+    while (currentToken.type != TokenType::BRACE_CLOSE && currentToken.type != TokenType::END) {
+        if (currentToken.type != TokenType::CASE && currentToken.type != TokenType::DEFAULT) {
+            if (switchStmt->cases.empty()) {
+                throw std::runtime_error("expected 'case' or 'default' before statements in switch");
+            }
+            switchStmt->cases.back().body->statements.push_back(parseStatement());
+            labelled = false;
+            continue;
+        }
+
+        if (!labelled) {
+            switchStmt->cases.emplace_back();
+            switchStmt->cases.back().body = std::make_unique<Block>();
+            labelled = true;
+        }
+        SwitchCase &section = switchStmt->cases.back();
+        if (currentToken.type == TokenType::DEFAULT) {
+            advance();
+            if (hasDefault) throw std::runtime_error("multiple 'default' labels in one switch");
+            hasDefault = section.isDefault = true;
+        } else {
+            advance();
+            int value = parseCaseValue();
+            if (!seen.insert(value).second) {
+                throw std::runtime_error("duplicate case value " + std::to_string(value));
+            }
+            section.values.push_back(value);
+        }
+        expect(TokenType::COLON, "':' after case label");
+    }
+    expect(TokenType::BRACE_CLOSE, "'}' after switch body");
+    return switchStmt;
+}
+
+/**
+ * @brief Parses the constant of a `case` label.
+ * 
+ * @return The value.
+ */
+int Parser::parseCaseValue() {
+    bool negative = currentToken.type == TokenType::OPERATOR && currentToken.value == "-";
+    if (negative) advance();
+    std::string digits = expect(TokenType::NUMBER, "a constant after 'case'");
+    return literalValue(digits, negative, "case value");
 }
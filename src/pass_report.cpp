@@ -0,0 +1,261 @@
+#include "pass_report.hpp"
+#include <llvm/ADT/Any.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Analysis/LazyCallGraph.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+
+namespace {
+
+/**
+ * @brief Pass managers, adaptors and proxies only run other passes; they are not reported.
+ */
+bool isContainer(llvm::StringRef pass) {
+    return llvm::isSpecialPass(pass, {"PassManager", "PassAdaptor", "AnalysisManagerProxy", "DevirtSCCRepeatedPass",
+                                      "ModuleInlinerWrapperPass"});
+}
+
+/**
+ * @brief Returns the name an IR unit is reported under.
+ * 
+ * Loops are attributed to their function and SCCs to their functions, joined by
+ * commas; module passes are reported under "<module>".
+ */
+std::string unitName(const llvm::Any &ir) {
+    if (llvm::any_isa<const llvm::Function *>(ir)) {
+        return llvm::any_cast<const llvm::Function *>(ir)->getName().str();
+    }
+    if (llvm::any_isa<const llvm::Loop *>(ir)) {
+        return llvm::any_cast<const llvm::Loop *>(ir)->getHeader()->getParent()->getName().str();
+    }
+    if (llvm::any_isa<const llvm::LazyCallGraph::SCC *>(ir)) {
+        std::string name;
+        for (const llvm::LazyCallGraph::Node &node : *llvm::any_cast<const llvm::LazyCallGraph::SCC *>(ir)) {
+            if (!name.empty()) name += ",";
+            name += node.getFunction().getName().str();
+        }
+        return name;
+    }
+    return "<module>";
+}
+
+/**
+ * @brief Returns the number of instructions in an IR unit.
+ */
+long instructionCount(const llvm::Any &ir) {
+    if (llvm::any_isa<const llvm::Function *>(ir)) {
+        return llvm::any_cast<const llvm::Function *>(ir)->getInstructionCount();
+    }
+    if (llvm::any_isa<const llvm::Loop *>(ir)) {
+        long count = 0;
+        for (const llvm::BasicBlock *block : llvm::any_cast<const llvm::Loop *>(ir)->blocks()) count += block->size();
+        return count;
+    }
+    if (llvm::any_isa<const llvm::LazyCallGraph::SCC *>(ir)) {
+        long count = 0;
+        for (const llvm::LazyCallGraph::Node &node : *llvm::any_cast<const llvm::LazyCallGraph::SCC *>(ir)) {
+            count += node.getFunction().getInstructionCount();
+        }
+        return count;
+    }
+    if (llvm::any_isa<const llvm::Module *>(ir)) {
+        return llvm::any_cast<const llvm::Module *>(ir)->getInstructionCount();
+    }
+    return 0;
+}
+
+} // namespace
+
+/**
+ * @brief Adds another set of totals to this one.
+ */
+void PassReport::Totals::add(const Totals &other) {
+    runs += other.runs;
+    changed += other.changed;
+    seconds += other.seconds;
+    instructionDelta += other.instructionDelta;
+}
+
+/**
+ * @brief Constructs a report.
+ * 
+ * @param timing Whether to include timings.
+ * @param statistics Whether to include change counts and LLVM statistics.
+ */
+PassReport::PassReport(bool timing, bool statistics) : timing(timing), statistics(statistics) {
+    if (statistics) llvm::EnableStatistics(false);
+}
+
+/**
+ * @brief Registers the report's callbacks for a pipeline about to be built.
+ * 
+ * Instructions are only counted when statistics are requested, since counting
+ * walks the whole IR unit before and after every pass.
+ * 
+ * @param callbacks The callbacks handed to the PassBuilder.
+ */
+void PassReport::registerCallbacks(llvm::PassInstrumentationCallbacks &callbacks) {
+    callbacks.registerBeforeNonSkippedPassCallback([this](llvm::StringRef pass, llvm::Any ir) {
+        if (isContainer(pass)) return;
+        begin(pass.str(), unitName(ir), false, statistics ? instructionCount(ir) : 0);
+    });
+    callbacks.registerAfterPassCallback(
+        [this](llvm::StringRef pass, llvm::Any ir, const llvm::PreservedAnalyses &preserved) {
+            if (isContainer(pass)) return;
+            end(!preserved.areAllPreserved(), statistics ? instructionCount(ir) : 0, statistics);
+        });
+    callbacks.registerAfterPassInvalidatedCallback(
+        [this](llvm::StringRef pass, const llvm::PreservedAnalyses &) {
+            // The IR unit is gone (e.g. a deleted loop), so there is nothing left to count.
+            if (isContainer(pass)) return;
+            end(true, 0, false);
+        });
+    callbacks.registerBeforeAnalysisCallback([this](llvm::StringRef analysis, llvm::Any ir) {
+        if (isContainer(analysis)) return;
+        begin(analysis.str(), unitName(ir), true, 0);
+    });
+    callbacks.registerAfterAnalysisCallback([this](llvm::StringRef analysis, llvm::Any) {
+        if (isContainer(analysis)) return;
+        end(false, 0, false);
+    });
+}
+
+/**
+ * @brief Records how long the JIT took to compile the program up to its first call.
+ * 
+ * @param seconds The time to first call.
+ * @param instructionSelector "FastISel" or "SelectionDAG".
+ */
+void PassReport::recordJIT(double seconds, const std::string &instructionSelector) {
+    jit = JITStartup{seconds, instructionSelector};
+}
+
+/**
+ * @brief Adds the passes of another report.
+ * 
+ * @param other The report to add.
+ */
+void PassReport::merge(const PassReport &other) {
+    for (const auto &[name, units] : other.passes) {
+        for (const auto &[unit, totals] : units) passes[name][unit].add(totals);
+    }
+    for (const auto &[name, units] : other.analyses) {
+        for (const auto &[unit, totals] : units) analyses[name][unit].add(totals);
+    }
+}
+
+/**
+ * @brief Records the start of a pass or analysis.
+ */
+void PassReport::begin(const std::string &name, const std::string &unit, bool analysis, long instructions) {
+    Running running{name, unit, analysis, Clock::now()};
+    running.instructionsBefore = instructions;
+    stack.push_back(std::move(running));
+}
+
+/**
+ * @brief Records the end of the innermost running pass or analysis.
+ * 
+ * Its inclusive time is charged to the enclosing entry as nested time, so that
+ * each entry's own time excludes what ran inside it.
+ */
+void PassReport::end(bool changed, long instructions, bool countInstructions) {
+    if (stack.empty()) return;
+    Running running = std::move(stack.back());
+    stack.pop_back();
+
+    double inclusive = std::chrono::duration<double>(Clock::now() - running.start).count();
+    if (!stack.empty()) stack.back().nestedSeconds += inclusive;
+
+    Totals &totals = (running.analysis ? analyses : passes)[running.name][running.unit];
+    totals.runs++;
+    if (changed) totals.changed++;
+    totals.seconds += inclusive - running.nestedSeconds;
+    if (countInstructions) totals.instructionDelta += instructions - running.instructionsBefore;
+}
+
+/**
+ * @brief Writes the report as JSON.
+ * 
+ * @param out The stream to write to.
+ */
+void PassReport::writeJSON(llvm::raw_ostream &out) const {
+    struct Entry {
+        const std::string *name;
+        bool analysis;
+        const std::map<std::string, Totals> *units;
+        Totals total;
+    };
+    std::vector<Entry> entries;
+    std::map<std::string, Totals> functions;
+    for (bool analysis : {false, true}) {
+        for (const auto &[name, units] : analysis ? analyses : passes) {
+            Entry entry{&name, analysis, &units, {}};
+            for (const auto &[unit, totals] : units) {
+                entry.total.add(totals);
+                if (unit != "<module>") functions[unit].add(totals);
+            }
+            entries.push_back(entry);
+        }
+    }
+    std::stable_sort(entries.begin(), entries.end(), [&](const Entry &a, const Entry &b) {
+        return timing ? a.total.seconds > b.total.seconds : a.total.changed > b.total.changed;
+    });
+
+    llvm::json::OStream json(out, 2);
+    auto writeTotals = [&](const Totals &totals) {
+        json.attribute("runs", static_cast<int64_t>(totals.runs));
+        if (timing) json.attribute("seconds", totals.seconds);
+        if (statistics) {
+            json.attribute("changed", static_cast<int64_t>(totals.changed));
+            json.attribute("instructionDelta", static_cast<int64_t>(totals.instructionDelta));
+        }
+    };
+
+    json.object([&] {
+        json.attributeArray("passes", [&] {
+            for (const Entry &entry : entries) {
+                json.object([&] {
+                    json.attribute("name", *entry.name);
+                    json.attribute("kind", entry.analysis ? "analysis" : "transform");
+                    writeTotals(entry.total);
+                    json.attributeArray("units", [&] {
+                        for (const auto &[unit, totals] : *entry.units) {
+                            json.object([&] {
+                                json.attribute("unit", unit);
+                                writeTotals(totals);
+                            });
+                        }
+                    });
+                });
+            }
+        });
+        json.attributeArray("functions", [&] {
+            for (const auto &[function, totals] : functions) {
+                json.object([&] {
+                    json.attribute("function", function);
+                    writeTotals(totals);
+                });
+            }
+        });
+        if (jit) {
+            json.attributeObject("jit", [&] {
+                json.attribute("instructionSelector", jit->instructionSelector);
+                if (timing) json.attribute("timeToFirstCallSeconds", jit->seconds);
+            });
+        }
+        if (statistics) {
+            json.attributeObject("llvmStatistics", [&] {
+                for (const auto &[name, value] : llvm::GetStatistics()) {
+                    json.attribute(name, static_cast<int64_t>(value));
+                }
+            });
+        }
+    });
+    out << "\n";
+}
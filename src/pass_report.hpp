@@ -0,0 +1,124 @@
+#ifndef PASS_REPORT_HPP
+#define PASS_REPORT_HPP
+
+#include <chrono>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class PassInstrumentationCallbacks;
+class raw_ostream;
+}
+
+/**
+ * @brief Collects per-pass timings and change counts while the optimizer runs.
+ * 
+ * The report hooks into the pass instrumentation callbacks of the new pass manager
+ * and attributes every pass and analysis run to the IR unit it ran on: a function
+ * for function and loop passes, the functions of an SCC for CGSCC passes, and the
+ * whole module for module passes. Times are exclusive, i.e. a pass manager or
+ * adaptor does not count the time of the passes it runs, so the times of all
+ * entries add up to the time spent in the pipeline.
+ * 
+ * With statistics enabled the report also counts how often each pass changed the
+ * IR and how many instructions it added or removed, and includes LLVM's own
+ * `Statistic` counters. Those are compiled out of LLVM builds without assertions
+ * unless LLVM_FORCE_ENABLE_STATS is set, in which case that section is empty.
+ */
+class PassReport {
+public:
+    /**
+     * @brief Constructs a report.
+     * 
+     * @param timing Whether to include timings.
+     * @param statistics Whether to include change counts and LLVM statistics.
+     */
+    PassReport(bool timing, bool statistics);
+
+    /**
+     * @brief Registers the report's callbacks for a pipeline about to be built.
+     * 
+     * @param callbacks The callbacks handed to the PassBuilder.
+     */
+    void registerCallbacks(llvm::PassInstrumentationCallbacks &callbacks);
+
+    /**
+     * @brief Records how long the JIT took to compile the program up to its first call.
+     * 
+     * Written as the report's "jit" object, after the optimizer's passes.
+     * 
+     * @param seconds The time from the start of the JIT until `main` could be called.
+     * @param instructionSelector "FastISel" or "SelectionDAG".
+     */
+    void recordJIT(double seconds, const std::string &instructionSelector);
+
+    /**
+     * @brief Adds the passes of another report, e.g. of a partition optimized on another thread.
+     * 
+     * Each pipeline reports into a report of its own, since reports are not thread
+     * safe; the parts are merged once the threads are done.
+     * 
+     * @param other The report to add; it must have finished running passes.
+     */
+    void merge(const PassReport &other);
+
+    /**
+     * @brief Writes the report as JSON.
+     * 
+     * Passes are listed from slowest to fastest (or most to least changing if
+     * timings are off), each broken down by IR unit, followed by the total per
+     * function, the JIT's time to first call if it ran, and LLVM's statistics.
+     * 
+     * @param out The stream to write to.
+     */
+    void writeJSON(llvm::raw_ostream &out) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Accumulated results of one pass or analysis on one IR unit.
+     */
+    struct Totals {
+        unsigned runs = 0;         ///< Number of times it ran.
+        unsigned changed = 0;      ///< Number of runs that did not preserve all analyses.
+        double seconds = 0;        ///< Exclusive time.
+        long instructionDelta = 0; ///< Instructions added minus instructions removed.
+
+        void add(const Totals &other);
+    };
+
+    /**
+     * @brief A pass or analysis that has started but not finished yet.
+     */
+    struct Running {
+        std::string name;           ///< Pass or analysis name.
+        std::string unit;           ///< IR unit it runs on.
+        bool analysis;              ///< Whether it is an analysis.
+        Clock::time_point start;    ///< Start time.
+        double nestedSeconds = 0;   ///< Time spent in passes it ran itself.
+        long instructionsBefore = 0; ///< Instruction count of the unit at the start.
+    };
+
+    void begin(const std::string &name, const std::string &unit, bool analysis, long instructions);
+    void end(bool changed, long instructions, bool countInstructions);
+
+    bool timing;     ///< Include timings.
+    bool statistics; ///< Include change counts and LLVM statistics.
+    std::vector<Running> stack; ///< Passes currently running, innermost last.
+    std::map<std::string, std::map<std::string, Totals>> passes;   ///< Transform pass -> unit -> totals.
+    std::map<std::string, std::map<std::string, Totals>> analyses; ///< Analysis -> unit -> totals.
+
+    /**
+     * @brief The JIT's start-up, if the program was run.
+     */
+    struct JITStartup {
+        double seconds;                  ///< Time to first call.
+        std::string instructionSelector; ///< "FastISel" or "SelectionDAG".
+    };
+    std::optional<JITStartup> jit; ///< Set by recordJIT.
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "profile.hpp"
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Module.h>
+#include <map>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief The counters of one instrumented function.
+ */
+struct FunctionCounters {
+    std::string name;                         ///< PGO name of the function.
+    uint64_t hash = 0;                        ///< CFG hash the profile must match.
+    llvm::GlobalVariable *counters = nullptr; ///< The counter array.
+};
+
+/**
+ * @brief Returns the string a `__profn_` name variable holds.
+ */
+std::string profileName(llvm::GlobalVariable *nameVar) {
+    auto *data = llvm::cast<llvm::ConstantDataArray>(nameVar->getInitializer());
+    return data->getAsString().str();
+}
+
+/**
+ * @brief Creates the function that writes all counters to the profile file.
+ * 
+ * The output is LLVM's text profile format for IR-level instrumentation: a `:ir`
+ * header, then per function its name, CFG hash, counter count and counter values.
+ */
+llvm::Function *createWriter(llvm::Module &module, const std::vector<FunctionCounters> &functions,
+                             const std::string &outputFile) {
+    llvm::LLVMContext &context = module.getContext();
+    llvm::IRBuilder<> builder(context);
+    auto *fileTy = builder.getInt8PtrTy();
+    auto fopen = module.getOrInsertFunction("fopen", fileTy, builder.getInt8PtrTy(), builder.getInt8PtrTy());
+    auto fclose = module.getOrInsertFunction("fclose", builder.getInt32Ty(), fileTy);
+    auto fprintf = module.getOrInsertFunction(
+        "fprintf", llvm::FunctionType::get(builder.getInt32Ty(), {fileTy, builder.getInt8PtrTy()}, true));
+
+    auto *writer = llvm::Function::Create(llvm::FunctionType::get(builder.getVoidTy(), false),
+                                          llvm::Function::InternalLinkage, "__toy_profile_write", module);
+    writer->addFnAttr(llvm::Attribute::NoInline);
+    auto *entry = llvm::BasicBlock::Create(context, "entry", writer);
+    auto *write = llvm::BasicBlock::Create(context, "write", writer);
+    auto *done = llvm::BasicBlock::Create(context, "done", writer);
+
+    builder.SetInsertPoint(entry);
+    llvm::Value *file = builder.CreateCall(
+        fopen, {builder.CreateGlobalStringPtr(outputFile, ".prof.path"), builder.CreateGlobalStringPtr("w", ".prof.mode")},
+        "file");
+    builder.CreateCondBr(builder.CreateIsNull(file), done, write);
+
+    builder.SetInsertPoint(write);
+    builder.CreateCall(fprintf, {file, builder.CreateGlobalStringPtr(":ir\n", ".prof.header")});
+    llvm::Value *functionFormat = builder.CreateGlobalStringPtr("%s\n%llu\n%u\n", ".prof.function");
+    llvm::Value *counterFormat = builder.CreateGlobalStringPtr("%llu\n", ".prof.counter");
+    llvm::Value *separator = builder.CreateGlobalStringPtr("\n", ".prof.separator");
+    for (const FunctionCounters &function : functions) {
+        auto *arrayTy = llvm::cast<llvm::ArrayType>(function.counters->getValueType());
+        unsigned count = static_cast<unsigned>(arrayTy->getNumElements());
+        builder.CreateCall(fprintf, {file, functionFormat, builder.CreateGlobalStringPtr(function.name, ".prof.name"),
+                                     builder.getInt64(function.hash), builder.getInt32(count)});
+        for (unsigned i = 0; i < count; i++) {
+            llvm::Value *counter = builder.CreateConstInBoundsGEP2_32(arrayTy, function.counters, 0, i);
+            builder.CreateCall(fprintf, {file, counterFormat, builder.CreateLoad(builder.getInt64Ty(), counter)});
+        }
+        builder.CreateCall(fprintf, {file, separator});
+    }
+    builder.CreateCall(fclose, {file});
+    builder.CreateBr(done);
+
+    builder.SetInsertPoint(done);
+    builder.CreateRetVoid();
+    return writer;
+}
+
+} // namespace
+
+/**
+ * @brief Lowers the counters of a module instrumented by PGOInstrumentationGen.
+ * 
+ * Counters are updated with a plain load, add and store, like LLVM's default
+ * non-atomic lowering; toy programs are single-threaded. The writer is called
+ * before every return from `main`, which also covers the JIT, where an atexit
+ * handler would run after the JIT'd code has been freed.
+ */
+llvm::PreservedAnalyses ProfileCounterLowering::run(llvm::Module &module, llvm::ModuleAnalysisManager &) {
+    std::map<llvm::GlobalVariable *, FunctionCounters> byName;
+    std::vector<llvm::GlobalVariable *> order;
+    std::vector<llvm::IntrinsicInst *> increments;
+
+    for (llvm::Function &function : module) {
+        bool instrumented = false;
+        for (llvm::Instruction &instruction : llvm::instructions(function)) {
+            auto *intrinsic = llvm::dyn_cast<llvm::IntrinsicInst>(&instruction);
+            if (!intrinsic || (intrinsic->getIntrinsicID() != llvm::Intrinsic::instrprof_increment &&
+                               intrinsic->getIntrinsicID() != llvm::Intrinsic::instrprof_increment_step)) {
+                continue;
+            }
+            auto *increment = llvm::cast<llvm::InstrProfInstBase>(intrinsic);
+            llvm::GlobalVariable *nameVar = increment->getName();
+            auto [entry, added] = byName.try_emplace(nameVar);
+            if (added) {
+                entry->second.name = profileName(nameVar);
+                entry->second.hash = increment->getHash()->getZExtValue();
+                auto *arrayTy = llvm::ArrayType::get(llvm::Type::getInt64Ty(module.getContext()),
+                                                     increment->getNumCounters()->getZExtValue());
+                entry->second.counters = new llvm::GlobalVariable(
+                    module, arrayTy, false, llvm::GlobalValue::PrivateLinkage, llvm::Constant::getNullValue(arrayTy),
+                    "__profc_" + function.getName());
+                order.push_back(nameVar);
+            }
+            increments.push_back(intrinsic);
+            instrumented = true;
+        }
+        if (instrumented) {
+            function.removeFnAttr(llvm::Attribute::ReadNone);
+            function.removeFnAttr(llvm::Attribute::ReadOnly);
+            function.removeFnAttr(llvm::Attribute::Speculatable);
+        }
+    }
+    if (increments.empty()) return llvm::PreservedAnalyses::all();
+
+    llvm::IRBuilder<> builder(module.getContext());
+    for (llvm::IntrinsicInst *intrinsic : increments) {
+        auto *increment = llvm::cast<llvm::InstrProfInstBase>(intrinsic);
+        llvm::Value *step = intrinsic->getIntrinsicID() == llvm::Intrinsic::instrprof_increment_step
+                                ? intrinsic->getArgOperand(4)
+                                : builder.getInt64(1);
+        llvm::GlobalVariable *counters = byName[increment->getName()].counters;
+
+        builder.SetInsertPoint(intrinsic);
+        llvm::Value *counter = builder.CreateConstInBoundsGEP2_32(
+            counters->getValueType(), counters, 0, static_cast<unsigned>(increment->getIndex()->getZExtValue()));
+        llvm::Value *value = builder.CreateLoad(builder.getInt64Ty(), counter);
+        builder.CreateStore(builder.CreateAdd(value, step), counter);
+        intrinsic->eraseFromParent();
+    }
+
+    std::vector<FunctionCounters> functions;
+    for (llvm::GlobalVariable *nameVar : order) functions.push_back(byName[nameVar]);
+    llvm::Function *writer = createWriter(module, functions, outputFile);
+
+    if (llvm::Function *main = module.getFunction("main")) {
+        main->removeFnAttr(llvm::Attribute::ReadNone);
+        main->removeFnAttr(llvm::Attribute::ReadOnly);
+        main->removeFnAttr(llvm::Attribute::Speculatable);
+        for (llvm::BasicBlock &block : *main) {
+            if (auto *ret = llvm::dyn_cast<llvm::ReturnInst>(block.getTerminator())) {
+                // Nothing may come between a musttail call and its return; main
+                // runs once, so it does not need the guarantee.
+                if (auto *call = llvm::dyn_cast_or_null<llvm::CallInst>(ret->getPrevNode())) {
+                    if (call->isMustTailCall()) call->setTailCallKind(llvm::CallInst::TCK_Tail);
+                }
+                builder.SetInsertPoint(ret);
+                builder.CreateCall(writer);
+            }
+        }
+    }
+    return llvm::PreservedAnalyses::none();
+}
@@ -0,0 +1,42 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <llvm/IR/PassManager.h>
+#include <string>
+
+/**
+ * @brief Lowers IR-level PGO counters without the compiler-rt profile runtime.
+ * 
+ * PGOInstrumentationGen marks every instrumented edge with an
+ * `llvm.instrprof.increment` intrinsic. LLVM's own lowering turns those into
+ * counters in special sections that the compiler-rt runtime writes out as a
+ * `.profraw` file at exit. The toy compiler cannot assume that runtime (it is
+ * not available to the JIT and often not installed), so this pass lowers the
+ * intrinsics itself: each function gets a private array of 64-bit counters, and
+ * `main` writes them to a file before it returns, in the text profile format that
+ * `llvm-profdata merge` reads just like `.profraw`:
+ * 
+ *     llvm-profdata merge -o app.profdata default.proftext
+ * 
+ * Since the counters are ordinary memory, the memory attributes that CodeGen
+ * inferred for instrumented functions no longer hold and are removed.
+ */
+class ProfileCounterLowering : public llvm::PassInfoMixin<ProfileCounterLowering> {
+public:
+    /**
+     * @brief Constructs the pass.
+     * 
+     * @param outputFile The file the instrumented program writes its profile to.
+     */
+    explicit ProfileCounterLowering(std::string outputFile) : outputFile(std::move(outputFile)) {}
+
+    /**
+     * @brief Lowers the counters of a module instrumented by PGOInstrumentationGen.
+     */
+    llvm::PreservedAnalyses run(llvm::Module &module, llvm::ModuleAnalysisManager &analyses);
+
+private:
+    std::string outputFile; ///< Where the profile is written at run time.
+};
+
+#endif
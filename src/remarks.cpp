@@ -0,0 +1,157 @@
+#include "remarks.hpp"
+#include <llvm/IR/DiagnosticHandler.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/LLVMRemarkStreamer.h>
+#include <llvm/Remarks/RemarkSerializer.h>
+#include <llvm/Remarks/RemarkStreamer.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/Regex.h>
+#include <llvm/Support/raw_ostream.h>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+/// The passes whose remarks are kept, matched against the remark's pass name.
+const char *const remarkPasses = "^(inline|always-inline|loop-vectorize|slp-vectorizer|licm|loop-unroll)$";
+
+/**
+ * @brief Returns the toy function the code a remark is about was written in.
+ * 
+ * That is the function the remark is in unless the code was inlined there; the
+ * line tables still place inlined code in its original function.
+ * 
+ * @return The function's name, or an empty name if the code has no location.
+ */
+llvm::StringRef sourceFunction(const llvm::DiagnosticInfoOptimizationBase &remark) {
+    auto *irRemark = llvm::dyn_cast<llvm::DiagnosticInfoIROptimization>(&remark);
+    if (!irRemark || !irRemark->getCodeRegion()) return {};
+
+    const llvm::DILocation *location = nullptr;
+    if (auto *instruction = llvm::dyn_cast<llvm::Instruction>(irRemark->getCodeRegion())) {
+        location = instruction->getDebugLoc().get();
+    } else if (auto *block = llvm::dyn_cast<llvm::BasicBlock>(irRemark->getCodeRegion())) {
+        for (const llvm::Instruction &instruction : *block) {
+            if ((location = instruction.getDebugLoc().get())) break;
+        }
+    }
+    return location ? location->getScope()->getSubprogram()->getName() : llvm::StringRef();
+}
+
+/**
+ * @brief The --remarks file and the filters remarks pass through on their way there.
+ */
+class RemarkWriter {
+public:
+    /**
+     * @brief Opens the file and compiles the filters.
+     * 
+     * @return False on failure (reported to std::cerr).
+     */
+    bool open(const CompilerOptions &options) {
+        std::string error;
+        functions = llvm::Regex(options.remarksFilter.empty() ? ".*" : options.remarksFilter);
+        if (!functions.isValid(error)) {
+            std::cerr << "Invalid --remarks-filter: " << error << "\n";
+            return false;
+        }
+
+        std::error_code openError;
+        out = std::make_unique<llvm::raw_fd_ostream>(options.remarksFile, openError);
+        if (openError) {
+            std::cerr << "Could not open " << options.remarksFile << ": " << openError.message() << "\n";
+            return false;
+        }
+        auto serializer = llvm::remarks::createRemarkSerializer(llvm::remarks::Format::YAML,
+                                                                llvm::remarks::SerializerMode::Separate, *out);
+        if (!serializer) {
+            std::cerr << "Could not write remarks: " << llvm::toString(serializer.takeError()) << "\n";
+            return false;
+        }
+        streamer = std::make_unique<llvm::remarks::RemarkStreamer>(std::move(*serializer),
+                                                                   llvm::StringRef(options.remarksFile));
+        if (llvm::Error filterError = streamer->setFilter(remarkPasses)) {
+            std::cerr << "Could not filter remarks: " << llvm::toString(std::move(filterError)) << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Returns true if remarks of a pass are kept, so that the pass builds them at all.
+     */
+    bool wantsPass(llvm::StringRef pass) const { return passes.match(pass); }
+
+    /**
+     * @brief Writes a remark if it concerns a function that passes the filter.
+     * 
+     * A remark concerns the function it is in, the function its code was written
+     * in, and for the inliner the callee.
+     */
+    void emit(const llvm::DiagnosticInfoOptimizationBase &remark) {
+        bool wanted = functions.match(remark.getFunction().getName()) || functions.match(sourceFunction(remark));
+        for (const auto &argument : remark.getArgs()) {
+            wanted = wanted || (argument.Key == "Callee" && functions.match(argument.Val));
+        }
+        if (!wanted) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        llvm::LLVMRemarkStreamer(*streamer).emit(remark);
+    }
+
+private:
+    llvm::Regex passes{remarkPasses}; ///< The passes whose remarks are kept.
+    llvm::Regex functions;            ///< The functions whose remarks are kept.
+    std::mutex mutex;                 ///< Serializes writes from concurrent contexts.
+    std::unique_ptr<llvm::raw_fd_ostream> out;                ///< The YAML file.
+    std::unique_ptr<llvm::remarks::RemarkStreamer> streamer; ///< Serializes remarks into out.
+};
+
+/**
+ * @brief Hands a context's optimization remarks to a RemarkWriter.
+ * 
+ * Other diagnostics are left to the context's default printing.
+ */
+class RemarkHandler : public llvm::DiagnosticHandler {
+public:
+    explicit RemarkHandler(RemarkWriter &writer) : writer(writer) {}
+
+    bool handleDiagnostics(const llvm::DiagnosticInfo &info) override {
+        auto *remark = llvm::dyn_cast<llvm::DiagnosticInfoOptimizationBase>(&info);
+        if (!remark) return false;
+        writer.emit(*remark);
+        return true;
+    }
+
+    bool isAnalysisRemarkEnabled(llvm::StringRef pass) const override { return writer.wantsPass(pass); }
+    bool isMissedOptRemarkEnabled(llvm::StringRef pass) const override { return writer.wantsPass(pass); }
+    bool isPassedOptRemarkEnabled(llvm::StringRef pass) const override { return writer.wantsPass(pass); }
+    bool isAnyRemarkEnabled() const override { return true; }
+
+private:
+    RemarkWriter &writer; ///< Where remarks go.
+};
+
+} // namespace
+
+/**
+ * @brief Streams a context's optimization remarks into the --remarks YAML file.
+ * 
+ * @param context The context to take remarks from.
+ * @param options The command line settings.
+ * @return False if the file cannot be opened or the filter is invalid.
+ */
+bool attachRemarks(llvm::LLVMContext &context, const CompilerOptions &options) {
+    static RemarkWriter writer;
+    static std::once_flag opened;
+    static bool ok = false;
+    std::call_once(opened, [&] { ok = writer.open(options); });
+    if (!ok) return false;
+
+    context.setDiagnosticHandler(std::make_unique<RemarkHandler>(writer));
+    context.setDiagnosticsHotnessRequested(!options.profileUse.empty());
+    return true;
+}
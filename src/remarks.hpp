@@ -0,0 +1,32 @@
+#ifndef REMARKS_HPP
+#define REMARKS_HPP
+
+#include "options.hpp"
+
+namespace llvm {
+class LLVMContext;
+}
+
+/**
+ * @brief Streams a context's optimization remarks into the --remarks YAML file.
+ * 
+ * The remarks kept are those of the inliner, the loop and SLP vectorizers, LICM
+ * and the loop unroller: what each did (passed), what it could not do and why
+ * (missed), and the analyses behind the decisions (analysis, e.g. the vectorizer's
+ * cost model). With --remarks-filter, only remarks in functions whose name matches
+ * the regular expression are kept. Each remark names its toy function; CodeGen's
+ * line tables (CodeGen::emitLineTables) give it the source line of its loop or
+ * statement. With --profile-use, remarks also carry the hotness of their code.
+ * 
+ * The file is opened on first use and shared by every context in the process,
+ * including those that optimize partitions and thin-linked modules on other
+ * threads; remarks are written whole, one YAML document each.
+ * 
+ * @param context The context to take remarks from; its diagnostic handler is replaced.
+ * @param options The command line settings: remarksFile, remarksFilter, profileUse.
+ * @return False if the file cannot be opened or the filter is not a valid regular
+ *         expression (reported to std::cerr).
+ */
+bool attachRemarks(llvm::LLVMContext &context, const CompilerOptions &options);
+
+#endif
@@ -0,0 +1,197 @@
+#include "resolver.hpp"
+#include <iostream>
+
+/**
+ * @brief Resolves all names in a program.
+ * 
+ * @param program The program to resolve; its nodes are annotated in place.
+ * @return True if no errors were found.
+ */
+bool Resolver::resolve(Program &program) {
+    this->program = &program;
+    for (auto &function : program.functions) {
+        Symbol symbol;
+        symbol.kind = Symbol::Kind::Function;
+        symbol.decl = function.get();
+        line = function->line;
+        if (function->name == "likely" || function->name == "unlikely") {
+            error("'" + function->name + "' is reserved for branch hints");
+        } else if (function->name == "print" || !symbols.declare(function->name, symbol)) {
+            error("redefinition of function '" + function->name + "'");
+        }
+    }
+
+    // External declarations are appended while resolving, and need no resolution.
+    size_t defined = program.functions.size();
+    for (size_t i = 0; i < defined; i++) {
+        resolveFunction(*program.functions[i]);
+    }
+    this->program = nullptr;
+    return ok;
+}
+
+/**
+ * @brief Resolves one function body in a fresh scope holding its parameters.
+ * 
+ * @param function The function to resolve.
+ */
+void Resolver::resolveFunction(FunctionDecl &function) {
+    current = &function;
+    function.numLocals = 0;
+    line = function.line;
+
+    symbols.pushScope();
+    for (const auto &param : function.params) {
+        int slot;
+        declareVariable(param, &function, slot);
+    }
+    // The body shares the parameters' scope, so `int a` in the body of f(int a) is a redeclaration.
+    for (auto &statement : function.body->statements) {
+        resolveNode(statement.get());
+    }
+    symbols.popScope();
+
+    current = nullptr;
+}
+
+/**
+ * @brief Resolves the names used by a statement or expression and its children.
+ * 
+ * @param node The node to resolve; may be null for absent optional children.
+ */
+void Resolver::resolveNode(ASTNode *node) {
+    if (!node) return;
+    // Statements carry their line; expressions report the line of their statement.
+    if (node->line) line = node->line;
+
+    if (auto *var = dynamic_cast<VariableExpr *>(node)) {
+        var->slot = lookupVariable(var->name);
+    } else if (auto *binary = dynamic_cast<BinaryExpr *>(node)) {
+        resolveNode(binary->left.get());
+        resolveNode(binary->right.get());
+    } else if (auto *call = dynamic_cast<FunctionCall *>(node)) {
+        for (auto &arg : call->args) resolveNode(arg.get());
+
+        if (call->name == "print") {
+            if (call->args.size() != 1) error("'print' takes exactly one argument");
+            return;
+        }
+        const Symbol *symbol = symbols.lookup(call->name);
+        if (!symbol) symbol = declareExternal(call->name);
+        if (!symbol) {
+            error("call to undeclared function '" + call->name + "'");
+        } else if (symbol->kind != Symbol::Kind::Function) {
+            error("'" + call->name + "' is not a function");
+        } else {
+            call->callee = static_cast<FunctionDecl *>(symbol->decl);
+            if (call->callee->params.size() != call->args.size()) {
+                error("'" + call->name + "' expects " + std::to_string(call->callee->params.size()) +
+                      " arguments, got " + std::to_string(call->args.size()));
+            }
+        }
+    } else if (auto *assign = dynamic_cast<Assignment *>(node)) {
+        resolveNode(assign->value.get());
+        assign->slot = lookupVariable(assign->name);
+    } else if (auto *decl = dynamic_cast<VarDecl *>(node)) {
+        // The initializer is resolved first, so `int x = x;` refers to an outer x.
+        resolveNode(decl->init.get());
+        declareVariable(decl->name, decl, decl->slot);
+    } else if (auto *block = dynamic_cast<Block *>(node)) {
+        symbols.pushScope();
+        for (auto &statement : block->statements) resolveNode(statement.get());
+        symbols.popScope();
+    } else if (auto *ifStmt = dynamic_cast<IfStatement *>(node)) {
+        resolveNode(ifStmt->condition.get());
+        resolveNode(ifStmt->thenBranch.get());
+        resolveNode(ifStmt->elseBranch.get());
+    } else if (auto *whileStmt = dynamic_cast<WhileStatement *>(node)) {
+        resolveNode(whileStmt->condition.get());
+        breakTargets++;
+        resolveNode(whileStmt->body.get());
+        breakTargets--;
+    } else if (auto *switchStmt = dynamic_cast<SwitchStatement *>(node)) {
+        resolveNode(switchStmt->condition.get());
+        breakTargets++;
+        for (auto &section : switchStmt->cases) resolveNode(section.body.get());
+        breakTargets--;
+    } else if (dynamic_cast<BreakStatement *>(node)) {
+        if (!breakTargets) error("'break' outside of a loop or switch in '" + current->name + "'");
+    } else if (auto *ret = dynamic_cast<ReturnStatement *>(node)) {
+        resolveNode(ret->value.get());
+    }
+}
+
+/**
+ * @brief Declares a parameter or local in the innermost scope and assigns it a slot.
+ * 
+ * @param name The variable name.
+ * @param decl The declaring node.
+ * @param slot Receives the new slot number.
+ */
+void Resolver::declareVariable(const std::string &name, ASTNode *decl, int &slot) {
+    Symbol symbol;
+    symbol.kind = Symbol::Kind::Variable;
+    symbol.slot = current->numLocals;
+    symbol.decl = decl;
+    if (!symbols.declare(name, symbol)) {
+        error("redeclaration of '" + name + "' in '" + current->name + "'");
+    }
+    slot = current->numLocals++;
+}
+
+/**
+ * @brief Looks up the slot of a variable that is being read or assigned.
+ * 
+ * @param name The variable name.
+ * @return The slot, or -1 after reporting an error.
+ */
+int Resolver::lookupVariable(const std::string &name) {
+    const Symbol *symbol = symbols.lookup(name);
+    if (!symbol) {
+        error("use of undeclared variable '" + name + "' in '" + current->name + "'");
+        return -1;
+    }
+    if (symbol->kind != Symbol::Kind::Variable) {
+        error("'" + name + "' is a function, not a variable");
+        return -1;
+    }
+    return symbol->slot;
+}
+
+/**
+ * @brief Declares a function defined in another source file, if there is one by that name.
+ * 
+ * The declaration is a body-less FunctionDecl appended to the program; later calls
+ * to the same name reuse it.
+ * 
+ * @param name The called name.
+ * @return The new function symbol, or null if no other file defines the name.
+ */
+const Symbol *Resolver::declareExternal(const std::string &name) {
+    if (!externals) return nullptr;
+    auto declared = externalSymbols.find(name);
+    if (declared != externalSymbols.end()) return &declared->second;
+    auto external = externals->find(name);
+    if (external == externals->end()) return nullptr;
+
+    std::vector<std::string> params;
+    for (size_t i = 0; i < external->second; i++) params.push_back("p" + std::to_string(i));
+    program->functions.push_back(std::make_unique<FunctionDecl>(name, std::move(params), nullptr));
+
+    Symbol &symbol = externalSymbols[name];
+    symbol.kind = Symbol::Kind::Function;
+    symbol.decl = program->functions.back().get();
+    return &symbol;
+}
+
+/**
+ * @brief Reports an error and marks the resolution as failed.
+ * 
+ * @param message The error message.
+ */
+void Resolver::error(const std::string &message) {
+    std::cerr << sourceFile;
+    if (line) std::cerr << ":" << line;
+    std::cerr << ": error: " << message << "\n";
+    ok = false;
+}
@@ -0,0 +1,65 @@
+#ifndef RESOLVER_HPP
+#define RESOLVER_HPP
+
+#include "ast.hpp"
+#include "symbol_table.hpp"
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief The functions other source files define, with their number of parameters.
+ */
+using ExternalFunctions = std::unordered_map<std::string, size_t>;
+
+/**
+ * @brief Binds every name in a Program to its declaration.
+ * 
+ * Functions are declared in the global scope before any body is visited, so calls may
+ * precede definitions. Within a function, each parameter and local gets a dense slot
+ * number that later passes use instead of the name; calls are bound to their
+ * FunctionDecl. A call to a function defined in another source file of the same
+ * program is bound to a body-less FunctionDecl that the Resolver appends to the
+ * Program. Errors (undeclared names, redeclarations, arity mismatches, a
+ * "break" outside of any loop or switch) are
+ * printed to std::cerr as they are found, as "<path>:<line>: error: ...", with
+ * the line of the statement or function they occur in.
+ */
+class Resolver {
+public:
+    /**
+     * @brief Constructs a resolver.
+     * 
+     * @param sourceFile The path of the program's source file, for error messages.
+     * @param externals Functions defined in the program's other source files; may be null.
+     */
+    explicit Resolver(std::string sourceFile, const ExternalFunctions *externals = nullptr)
+        : sourceFile(std::move(sourceFile)), externals(externals) {}
+
+    /**
+     * @brief Resolves all names in a program.
+     * 
+     * @param program The program to resolve; its nodes are annotated in place.
+     * @return True if no errors were found.
+     */
+    bool resolve(Program &program);
+
+private:
+    void resolveFunction(FunctionDecl &function);
+    void resolveNode(ASTNode *node);
+    void declareVariable(const std::string &name, ASTNode *decl, int &slot);
+    int lookupVariable(const std::string &name);
+    const Symbol *declareExternal(const std::string &name);
+    void error(const std::string &message);
+
+    std::string sourceFile;             ///< The program's source file, for error messages.
+    unsigned line = 0;                  ///< Line of the statement being resolved; 0 if unknown.
+    SymbolTable symbols;                ///< Names visible at the current point.
+    const ExternalFunctions *externals; ///< Functions of other source files, or null.
+    Program *program = nullptr;         ///< The program being resolved; receives external declarations.
+    std::unordered_map<std::string, Symbol> externalSymbols; ///< External functions declared so far.
+    FunctionDecl *current = nullptr;    ///< The function being resolved.
+    unsigned breakTargets = 0;          ///< Enclosing "while" and "switch" statements, which "break" may leave.
+    bool ok = true;                     ///< Cleared on the first error.
+};
+
+#endif
@@ -0,0 +1,82 @@
+#include "runtime_link.hpp"
+#include "toy_runtime.h"
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Transforms/IPO/Internalize.h>
+#include <cstddef>
+#include <iostream>
+
+// runtime/print.ll, assembled and embedded by the build (runtime/embed.cmake)
+extern const unsigned char toyRuntimeBitcode[];
+extern const size_t toyRuntimeBitcodeSize;
+
+namespace {
+
+/**
+ * @brief Checks that the runtime's %ToyOutput matches struct ToyOutput of toy_runtime.h.
+ * 
+ * toy_print writes into the buffer the C runtime allocates, so a layout that
+ * differs would corrupt memory silently.
+ * 
+ * @return False if the layouts differ (reported to std::cerr).
+ */
+bool checkBufferLayout(const llvm::Module &runtime) {
+    const llvm::Function *output = runtime.getFunction("toy_output");
+    auto *type = output ? llvm::dyn_cast<llvm::StructType>(output->getReturnType()->getPointerElementType()) : nullptr;
+    if (!type || type->getNumElements() != 3) {
+        std::cerr << "The runtime bitcode has no toy_output returning a %ToyOutput\n";
+        return false;
+    }
+    const llvm::StructLayout *layout = runtime.getDataLayout().getStructLayout(type);
+    if (layout->getSizeInBytes() != sizeof(ToyOutput) || layout->getElementOffset(0) != offsetof(ToyOutput, used) ||
+        layout->getElementOffset(1) != offsetof(ToyOutput, capacity) ||
+        layout->getElementOffset(2) != offsetof(ToyOutput, data)) {
+        std::cerr << "The runtime bitcode's %ToyOutput (" << layout->getSizeInBytes()
+                  << " bytes) does not match struct ToyOutput in toy_runtime.h (" << sizeof(ToyOutput) << " bytes)\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+/**
+ * @brief Links the runtime functions a module calls into it.
+ * 
+ * @param module The module.
+ * @return False if the runtime could not be loaded or linked.
+ */
+bool linkRuntime(llvm::Module &module) {
+    llvm::StringRef bitcode(reinterpret_cast<const char *>(toyRuntimeBitcode), toyRuntimeBitcodeSize);
+    llvm::Expected<std::unique_ptr<llvm::Module>> runtime =
+        llvm::getLazyBitcodeModule(llvm::MemoryBufferRef(bitcode, "toy_runtime"), module.getContext());
+    if (!runtime) {
+        std::cerr << "Could not load the runtime: " << llvm::toString(runtime.takeError()) << "\n";
+        return false;
+    }
+    // The runtime is target independent; adopt the module's target, whose data layout
+    // CodeGen::setTarget took from the target machine, so the two match
+    (*runtime)->setTargetTriple(module.getTargetTriple());
+    (*runtime)->setDataLayout(module.getDataLayout());
+    if (!checkBufferLayout(**runtime)) return false;
+
+    // LinkOnlyNeeded materializes only the definitions the module refers to
+    bool failed = llvm::Linker::linkModules(
+        module, std::move(*runtime), llvm::Linker::LinkOnlyNeeded,
+        [](llvm::Module &linked, const llvm::StringSet<> &runtimeNames) {
+            llvm::internalizeModule(linked, [&](const llvm::GlobalValue &value) {
+                return !runtimeNames.count(value.getName());
+            });
+        });
+    if (failed) {
+        std::cerr << "Could not link the runtime into " << module.getModuleIdentifier() << "\n";
+        return false;
+    }
+    return true;
+}
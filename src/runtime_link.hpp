@@ -0,0 +1,26 @@
+#ifndef RUNTIME_LINK_HPP
+#define RUNTIME_LINK_HPP
+
+namespace llvm {
+class Module;
+}
+
+/**
+ * @brief Links the runtime functions a module calls into it, ready to be optimized with it.
+ * 
+ * The runtime's IR half (runtime/print.ll) is embedded in the compiler as bitcode.
+ * It is loaded lazily, so only the bodies of the functions the module declares
+ * and uses are read, and those are linked in with internal linkage: the inliner
+ * can then inline toy_print's formatting into the program's loops, and every
+ * module of a program can carry its own copy. Its remaining external calls
+ * (the buffer and its flushing) are left to the toy_runtime library.
+ * 
+ * Call it after code generation and before the Optimizer. The module must already
+ * carry the target's data layout (CodeGen::setTarget), which the runtime adopts.
+ * 
+ * @param module The module.
+ * @return False if the runtime could not be loaded or linked (reported to std::cerr).
+ */
+bool linkRuntime(llvm::Module &module);
+
+#endif
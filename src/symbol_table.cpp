@@ -0,0 +1,146 @@
+#include "symbol_table.hpp"
+
+/**
+ * @brief Constructs an empty table holding only the outermost (global) scope.
+ * 
+ * @param expectedNames Number of distinct names to size the table for up front.
+ */
+SymbolTable::SymbolTable(size_t expectedNames) {
+    size_t bucketCount = 16;
+    while (bucketCount < expectedNames * 2) bucketCount *= 2;
+    buckets.assign(bucketCount, {EMPTY, 0});
+    entries.reserve(expectedNames);
+}
+
+/**
+ * @brief Opens a new innermost scope by remembering where the undo log ends.
+ */
+void SymbolTable::pushScope() { scopeMarks.push_back(undoLog.size()); }
+
+/**
+ * @brief Closes the innermost scope, restoring every binding it shadowed.
+ * 
+ * Records are replayed newest first so that a name declared twice in nested
+ * scopes ends up with its oldest binding. Entries stay in the index with their
+ * bound flag cleared, which keeps probe chains intact without tombstones.
+ */
+void SymbolTable::popScope() {
+    if (scopeMarks.empty()) return;
+    size_t mark = scopeMarks.back();
+    scopeMarks.pop_back();
+
+    while (undoLog.size() > mark) {
+        const UndoRecord &record = undoLog.back();
+        Entry &entry = entries[record.entry];
+        entry.bound = record.wasBound;
+        entry.symbol = record.previous;
+        undoLog.pop_back();
+    }
+}
+
+/**
+ * @brief Binds a name in the innermost scope.
+ * 
+ * @param name The name to bind.
+ * @param symbol What the name denotes; its depth is overwritten with the current depth.
+ * @return False if the name is already declared in the innermost scope.
+ */
+bool SymbolTable::declare(const std::string &name, Symbol symbol) {
+    uint32_t hash = hashName(name);
+    uint32_t index = findEntry(name, hash);
+    if (index == EMPTY) index = insertEntry(name, hash);
+
+    Entry &entry = entries[index];
+    if (entry.bound && entry.symbol.depth == depth()) return false;
+
+    undoLog.push_back({index, entry.bound, entry.symbol});
+    symbol.depth = depth();
+    entry.symbol = symbol;
+    entry.bound = true;
+    return true;
+}
+
+/**
+ * @brief Finds the innermost visible binding of a name.
+ * 
+ * @param name The name to look up.
+ * @return The binding, or null if the name is not in scope.
+ */
+const Symbol *SymbolTable::lookup(const std::string &name) const {
+    uint32_t index = findEntry(name, hashName(name));
+    if (index == EMPTY || !entries[index].bound) return nullptr;
+    return &entries[index].symbol;
+}
+
+/**
+ * @brief Hashes a name with 32-bit FNV-1a.
+ * 
+ * @param name The name to hash.
+ * @return The hash value.
+ */
+uint32_t SymbolTable::hashName(const std::string &name) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Probes the index for a name.
+ * 
+ * @param name The name to find.
+ * @param hash The name's hash.
+ * @return The entry index, or EMPTY if the name has never been declared.
+ */
+uint32_t SymbolTable::findEntry(const std::string &name, uint32_t hash) const {
+    size_t mask = buckets.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Bucket &bucket = buckets[i];
+        if (bucket.entry == EMPTY) return EMPTY;
+        if (bucket.hash == hash && entries[bucket.entry].name == name) return bucket.entry;
+    }
+}
+
+/**
+ * @brief Adds an unbound entry for a name not yet in the index.
+ * 
+ * The index is kept at most half full so that probe sequences stay short.
+ * 
+ * @param name The name to add.
+ * @param hash The name's hash.
+ * @return The index of the new entry.
+ */
+uint32_t SymbolTable::insertEntry(const std::string &name, uint32_t hash) {
+    if ((entries.size() + 1) * 2 > buckets.size()) rehash(buckets.size() * 2);
+
+    uint32_t index = static_cast<uint32_t>(entries.size());
+    entries.push_back({name, Symbol(), false});
+
+    size_t mask = buckets.size() - 1;
+    size_t i = hash & mask;
+    while (buckets[i].entry != EMPTY) i = (i + 1) & mask;
+    buckets[i] = {index, hash};
+    return index;
+}
+
+/**
+ * @brief Rebuilds the index with a new bucket count.
+ * 
+ * Only the index moves; entry indices, and so the undo log, stay valid.
+ * 
+ * @param bucketCount The new number of buckets, a power of two.
+ */
+void SymbolTable::rehash(size_t bucketCount) {
+    std::vector<Bucket> old(bucketCount, {EMPTY, 0});
+    old.swap(buckets);
+
+    size_t mask = buckets.size() - 1;
+    for (const Bucket &bucket : old) {
+        if (bucket.entry == EMPTY) continue;
+        size_t i = bucket.hash & mask;
+        while (buckets[i].entry != EMPTY) i = (i + 1) & mask;
+        buckets[i] = bucket;
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef SYMBOL_TABLE_HPP
+#define SYMBOL_TABLE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ASTNode;
+
+/**
+ * @brief What a name is bound to in a scope.
+ */
+struct Symbol {
+    /**
+     * @brief The kinds of entities a name can denote.
+     */
+    enum class Kind {
+        Function, /**< A function defined in the program */
+        Variable  /**< A parameter or local variable */
+    };
+
+    Kind kind = Kind::Variable; ///< The kind of entity the name denotes.
+    int slot = -1;              ///< The variable's slot in its function (variables only).
+    ASTNode *decl = nullptr;    ///< The declaring node (FunctionDecl, VarDecl, or the function for parameters).
+    unsigned depth = 0;         ///< Scope depth of the declaration, filled in by SymbolTable::declare.
+};
+
+/**
+ * @brief A scoped symbol table built on one flat open-addressing hash map.
+ * 
+ * Every distinct name owns one entry holding its innermost visible binding. Declaring
+ * a name pushes the binding it shadows onto an undo log, and popping a scope replays
+ * the log back to the mark taken when the scope was pushed. Lookup is therefore a
+ * single hash probe regardless of nesting depth, and leaving a scope costs only as
+ * much as the declarations made in it; no per-scope map is ever allocated.
+ */
+class SymbolTable {
+public:
+    /**
+     * @brief Constructs an empty table holding only the outermost (global) scope.
+     * 
+     * @param expectedNames Number of distinct names to size the table for up front.
+     */
+    explicit SymbolTable(size_t expectedNames = 64);
+
+    /**
+     * @brief Opens a new innermost scope.
+     */
+    void pushScope();
+
+    /**
+     * @brief Closes the innermost scope, restoring every binding it shadowed.
+     */
+    void popScope();
+
+    /**
+     * @brief Binds a name in the innermost scope.
+     * 
+     * @param name The name to bind.
+     * @param symbol What the name denotes; its depth is overwritten with the current depth.
+     * @return False if the name is already declared in the innermost scope.
+     */
+    bool declare(const std::string &name, Symbol symbol);
+
+    /**
+     * @brief Finds the innermost visible binding of a name.
+     * 
+     * @param name The name to look up.
+     * @return The binding, or null if the name is not in scope. The pointer stays valid
+     *         until the next declare or popScope.
+     */
+    const Symbol *lookup(const std::string &name) const;
+
+    /**
+     * @brief Returns the current nesting depth; the global scope is depth 0.
+     */
+    unsigned depth() const { return static_cast<unsigned>(scopeMarks.size()); }
+
+private:
+    /**
+     * @brief One distinct name and its innermost binding.
+     */
+    struct Entry {
+        std::string name; ///< The name itself.
+        Symbol symbol;    ///< The innermost binding, meaningful only while bound is set.
+        bool bound;       ///< Whether any scope currently binds the name.
+    };
+
+    /**
+     * @brief A hash slot: entry index plus the full hash to reject mismatches cheaply.
+     */
+    struct Bucket {
+        uint32_t entry; ///< Index into entries, or EMPTY.
+        uint32_t hash;  ///< Hash of the entry's name.
+    };
+
+    /**
+     * @brief The state of an entry before a declaration overwrote it.
+     */
+    struct UndoRecord {
+        uint32_t entry;  ///< Index of the overwritten entry.
+        bool wasBound;   ///< Whether the entry held a binding before.
+        Symbol previous; ///< The shadowed binding, if there was one.
+    };
+
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    static uint32_t hashName(const std::string &name);
+    uint32_t findEntry(const std::string &name, uint32_t hash) const;
+    uint32_t insertEntry(const std::string &name, uint32_t hash);
+    void rehash(size_t bucketCount);
+
+    std::vector<Bucket> buckets;        ///< Open-addressing index, size is a power of two.
+    std::vector<Entry> entries;         ///< Entries in insertion order; indices are stable.
+    std::vector<UndoRecord> undoLog;    ///< Shadowed bindings, newest last.
+    std::vector<size_t> scopeMarks;     ///< Undo log size at each pushScope.
+};
+
+#endif
@@ -0,0 +1,258 @@
+#include "thin_link.hpp"
+#include "backend.hpp"
+#include "code_size.hpp"
+#include "optimizer.hpp"
+#include "pass_report.hpp"
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Analysis/BlockFrequencyInfo.h>
+#include <llvm/Analysis/BranchProbabilityInfo.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ModuleSummaryAnalysis.h>
+#include <llvm/Analysis/ProfileSummaryInfo.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/ModuleSummaryIndex.h>
+#include <llvm/LTO/LTO.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Transforms/IPO/FunctionImport.h>
+#include <llvm/Transforms/Utils/FunctionImportUtils.h>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+/**
+ * @brief The block frequencies of one function, with the analyses they are computed from.
+ * 
+ * BlockFrequencyInfo keeps pointers to the loop and branch probability analyses,
+ * so all of them live together.
+ */
+struct FunctionFrequencies {
+    explicit FunctionFrequencies(llvm::Function &function)
+        : dominators(function), loops(dominators), probabilities(function, loops),
+          frequencies(function, probabilities, loops) {}
+
+    llvm::DominatorTree dominators;            ///< Needed by the loop analysis.
+    llvm::LoopInfo loops;                      ///< Loops, for the branch probabilities.
+    llvm::BranchProbabilityInfo probabilities; ///< Branch probabilities, from the profile when there is one.
+    llvm::BlockFrequencyInfo frequencies;      ///< The block frequencies themselves.
+};
+
+/**
+ * @brief Returns a view of a module's bitcode under its module identifier.
+ */
+llvm::MemoryBufferRef bitcodeBuffer(const SummarizedModule &module) {
+    return llvm::MemoryBufferRef(llvm::StringRef(module.bitcode.data(), module.bitcode.size()), module.path);
+}
+
+/**
+ * @brief Imports into one module and compiles it; the ThinLTO backend of one file.
+ * 
+ * @param modules All modules of the program; imported functions are loaded lazily from them.
+ * @param unit The module to compile.
+ * @param index The combined summary after the thin link.
+ * @param imports The functions to import into the module, by source module.
+ * @param defined The summaries of the globals the module defines.
+ * @param options The command line settings.
+ * @param report Receives the PostSplit pipeline's timings and statistics; may be null.
+ * @param out Receives the textual IR, assembly or object code.
+ * @return False if any step failed (reported to std::cerr).
+ */
+bool compileModule(const std::vector<SummarizedModule> &modules, const SummarizedModule &unit,
+                   const llvm::ModuleSummaryIndex &index, const llvm::FunctionImporter::ImportMapTy &imports,
+                   const llvm::GVSummaryMapTy &defined, const CompilerOptions &options, PassReport *report,
+                   llvm::SmallVector<char, 0> &out) {
+    llvm::LLVMContext context;
+    llvm::Expected<std::unique_ptr<llvm::Module>> parsed = llvm::parseBitcodeFile(bitcodeBuffer(unit), context);
+    if (!parsed) {
+        std::cerr << unit.path << ": could not read bitcode: " << llvm::toString(parsed.takeError()) << "\n";
+        return false;
+    }
+    llvm::Module &module = **parsed;
+    std::unique_ptr<llvm::TargetMachine> machine = createTargetMachine(module, options);
+    if (!machine) return false;
+
+    // Declarations of functions defined elsewhere stop being dso_local when the
+    // code is position independent, exactly as in the LTO library's backends.
+    bool clearDSOLocal = machine->getTargetTriple().isOSBinFormatELF() &&
+                         machine->getRelocationModel() != llvm::Reloc::Static &&
+                         module.getPIELevel() == llvm::PIELevel::Default;
+    if (llvm::renameModuleForThinLTO(module, index, clearDSOLocal)) {
+        std::cerr << unit.path << ": could not promote the module's exported locals\n";
+        return false;
+    }
+    llvm::thinLTOFinalizeInModule(module, defined, /*PropagateAttrs=*/false);
+    llvm::thinLTOInternalizeModule(module, defined);
+
+    auto loader = [&](llvm::StringRef identifier) -> llvm::Expected<std::unique_ptr<llvm::Module>> {
+        for (const SummarizedModule &source : modules) {
+            if (source.path == identifier) {
+                return llvm::getLazyBitcodeModule(bitcodeBuffer(source), context, /*ShouldLazyLoadMetadata=*/true,
+                                                  /*IsImporting=*/true);
+            }
+        }
+        return llvm::createStringError(llvm::inconvertibleErrorCode(), "no module " + identifier.str());
+    };
+    llvm::FunctionImporter importer(index, loader, clearDSOLocal);
+    llvm::Expected<bool> imported = importer.importFunctions(module, imports);
+    if (!imported) {
+        std::cerr << unit.path << ": import failed: " << llvm::toString(imported.takeError()) << "\n";
+        return false;
+    }
+
+    if (!Optimizer(options, report, PipelineStage::PostSplit).run(module)) return false;
+    if (options.emit == EmitKind::IR) {
+        llvm::raw_svector_ostream stream(out);
+        module.print(stream, nullptr);
+        return true;
+    }
+    bool assembly = options.emit == EmitKind::Asm;
+    return generateCode(module, *machine, assembly ? llvm::CGFT_AssemblyFile : llvm::CGFT_ObjectFile, out);
+}
+
+} // namespace
+
+/**
+ * @brief Writes a module as bitcode together with its module summary.
+ * 
+ * Call hotness needs block frequencies, which are only computed when the module
+ * carries a profile summary; without a profile every call edge is of unknown
+ * hotness and importing goes by size alone.
+ * 
+ * @param module The module, optimized with the PreSplit stage.
+ * @param out Receives the bitcode.
+ */
+void writeSummarizedBitcode(llvm::Module &module, llvm::SmallVectorImpl<char> &out) {
+    llvm::ProfileSummaryInfo profile(module);
+    std::vector<std::unique_ptr<FunctionFrequencies>> frequencies;
+    auto getFrequencies = [&](const llvm::Function &function) -> llvm::BlockFrequencyInfo * {
+        if (!profile.hasProfileSummary()) return nullptr;
+        frequencies.push_back(std::make_unique<FunctionFrequencies>(const_cast<llvm::Function &>(function)));
+        return &frequencies.back()->frequencies;
+    };
+    llvm::ModuleSummaryIndex index = llvm::buildModuleSummaryIndex(module, getFrequencies, &profile);
+
+    // The module hash names the locals the module exports once they are promoted.
+    llvm::raw_svector_ostream stream(out);
+    llvm::WriteBitcodeToFile(module, stream, /*ShouldPreserveUseListOrder=*/false, &index, /*GenerateHash=*/true);
+}
+
+/**
+ * @brief Links the modules of a program ThinLTO-style and writes the result.
+ * 
+ * @param modules The program's modules.
+ * @param options The command line settings.
+ * @param report Receives the post-link pipelines' timings and statistics; may be null.
+ * @return False if any step failed.
+ */
+bool emitThinLinked(const std::vector<SummarizedModule> &modules, const CompilerOptions &options,
+                    PassReport *report) {
+    if (options.emit == EmitKind::Bitcode) {
+        for (const SummarizedModule &unit : modules) {
+            llvm::StringRef bitcode(unit.bitcode.data(), unit.bitcode.size());
+            if (!writeFile(defaultOutputFile(unit.path, "bc"), bitcode)) return false;
+        }
+        return true;
+    }
+
+    // The thin link proper, on the summaries alone: liveness from main, then the
+    // import lists, then which definitions other modules still need.
+    llvm::ModuleSummaryIndex index(/*HaveGVs=*/false);
+    for (size_t i = 0; i < modules.size(); i++) {
+        if (llvm::Error error = llvm::readModuleSummaryIndex(bitcodeBuffer(modules[i]), index, i)) {
+            std::cerr << modules[i].path << ": could not read the module summary: "
+                      << llvm::toString(std::move(error)) << "\n";
+            return false;
+        }
+    }
+    llvm::DenseSet<llvm::GlobalValue::GUID> preserved{llvm::GlobalValue::getGUID("main")};
+    llvm::computeDeadSymbolsWithConstProp(
+        index, preserved, [](llvm::GlobalValue::GUID) { return llvm::PrevailingType::Yes; },
+        /*ImportEnabled=*/true);
+
+    llvm::StringMap<llvm::GVSummaryMapTy> definedPerModule;
+    index.collectDefinedGVSummariesPerModule(definedPerModule);
+    llvm::StringMap<llvm::FunctionImporter::ImportMapTy> importLists;
+    llvm::StringMap<llvm::FunctionImporter::ExportSetTy> exportLists;
+    if (options.optLevel != OptLevel::O0) {
+        llvm::ComputeCrossModuleImport(index, definedPerModule, importLists, exportLists);
+    }
+
+    // A function called from another module stays external there even if that
+    // module imports it, since the import may not be inlined everywhere.
+    llvm::DenseSet<llvm::GlobalValue::GUID> calledElsewhere(preserved);
+    for (const auto &module : definedPerModule) {
+        for (const auto &[guid, summary] : module.second) {
+            auto *function = llvm::dyn_cast<llvm::FunctionSummary>(summary);
+            if (!function) continue;
+            for (const auto &[callee, info] : function->calls()) {
+                if (!module.second.count(callee.getGUID())) calledElsewhere.insert(callee.getGUID());
+            }
+        }
+    }
+    auto isExported = [&](llvm::StringRef modulePath, llvm::ValueInfo value) {
+        if (calledElsewhere.count(value.getGUID())) return true;
+        auto exports = exportLists.find(modulePath);
+        return exports != exportLists.end() && exports->second.count(value);
+    };
+    llvm::thinLTOInternalizeAndPromoteInIndex(
+        index, isExported, [](llvm::GlobalValue::GUID, const llvm::GlobalValueSummary *) { return true; });
+
+    // The per-module backends. The StringMaps are filled in before any thread
+    // starts, since operator[] may insert.
+    std::vector<const llvm::FunctionImporter::ImportMapTy *> imports;
+    std::vector<const llvm::GVSummaryMapTy *> defined;
+    for (const SummarizedModule &unit : modules) {
+        imports.push_back(&importLists[unit.path]);
+        defined.push_back(&definedPerModule[unit.path]);
+    }
+    unsigned jobs = options.jobs ? options.jobs : llvm::hardware_concurrency().compute_thread_count();
+    std::vector<llvm::SmallVector<char, 0>> outputs(modules.size());
+    std::vector<char> compiled(modules.size(), false); // not vector<bool>: written concurrently
+    std::vector<std::unique_ptr<PassReport>> reports(modules.size());
+    {
+        llvm::ThreadPool pool(llvm::hardware_concurrency(std::min<size_t>(jobs, modules.size())));
+        for (size_t i = 0; i < modules.size(); i++) {
+            if (report) reports[i] = std::make_unique<PassReport>(options.timePasses, options.stats);
+            pool.async([&, i] {
+                compiled[i] = compileModule(modules, modules[i], index, *imports[i], *defined[i], options,
+                                            reports[i].get(), outputs[i]);
+            });
+        }
+        pool.wait();
+    }
+    for (const auto &module : reports) {
+        if (module) report->merge(*module);
+    }
+    if (!std::all_of(compiled.begin(), compiled.end(), [](char ok) { return ok; })) return false;
+
+    bool objects = options.emit == EmitKind::Object || options.emit == EmitKind::Executable;
+    if (options.size && objects) {
+        CodeSizeReport sizes;
+        for (const auto &object : outputs) sizes.add(llvm::StringRef(object.data(), object.size()));
+        sizes.print(llvm::errs());
+    } else if (options.size) {
+        std::cerr << "note: the code size report needs object code (--emit=obj or --emit=exe)\n";
+    }
+
+    if (options.emit == EmitKind::Executable || !options.outputFile.empty()) {
+        std::string path = options.outputFile;
+        if (path.empty()) path = defaultOutputFile(modules.front().path, "");
+        return writeObjects(outputs, options, path);
+    }
+    const char *extension = options.emit == EmitKind::IR ? "ll" : options.emit == EmitKind::Asm ? "s" : "o";
+    for (size_t i = 0; i < modules.size(); i++) {
+        llvm::StringRef contents(outputs[i].data(), outputs[i].size());
+        if (!writeFile(defaultOutputFile(modules[i].path, extension), contents)) return false;
+    }
+    return true;
+}
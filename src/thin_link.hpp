@@ -0,0 +1,57 @@
+#ifndef THIN_LINK_HPP
+#define THIN_LINK_HPP
+
+#include "options.hpp"
+#include <llvm/ADT/SmallVector.h>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class Module;
+}
+class PassReport;
+
+/**
+ * @brief One source file of a program, compiled to bitcode with a module summary.
+ */
+struct SummarizedModule {
+    std::string path;                   ///< The source file; also the module identifier.
+    llvm::SmallVector<char, 0> bitcode; ///< Bitcode carrying a ThinLTO summary block.
+};
+
+/**
+ * @brief Writes a module as bitcode together with its module summary.
+ * 
+ * The summary lists every global, its linkage and size, and the calls each
+ * function makes, with their hotness when the module was optimized with a
+ * profile. It is what the thin link reads instead of the IR.
+ * 
+ * @param module The module, optimized with the PreSplit stage.
+ * @param out Receives the bitcode.
+ */
+void writeSummarizedBitcode(llvm::Module &module, llvm::SmallVectorImpl<char> &out);
+
+/**
+ * @brief Links the modules of a program ThinLTO-style and writes the result.
+ * 
+ * The thin link combines the summaries only: it finds the symbols nothing can
+ * reach from `main`, decides which small (and, with a profile, hot) callees each
+ * module imports from the others, and which definitions no other module needs
+ * and can become internal. The modules are then imported into and optimized with
+ * the PostSplit stage in parallel, each on a thread and in an LLVMContext of its
+ * own, and code is generated for them.
+ * 
+ * --emit=bc writes each module's summarized bitcode without linking. Textual IR,
+ * assembly and objects are written next to each source file; -o combines the
+ * objects into one. An executable is linked from all of them.
+ * 
+ * @param modules The program's modules; their functions have external linkage.
+ * @param options The command line settings; jobs is the number of threads.
+ * @param report Receives the timings and statistics of the modules' PostSplit
+ *        pipelines, merged once all of them are done; may be null.
+ * @return False if any step failed (reported to std::cerr).
+ */
+bool emitThinLinked(const std::vector<SummarizedModule> &modules, const CompilerOptions &options,
+                    PassReport *report = nullptr);
+
+#endif